@@ -0,0 +1,190 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the conversion of blocks of fields. Compares the conversion 
+// loops of convert_fields with the per field dispatch used by 
+// Reader::read_block, in which the reader moves to the next line after which
+// every column is assigned through virtual calls to the column and the 
+// reader. The fields are stored as spans (csv) and in stripes (fixed width).
+
+#include "conversion.h"
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+  const unsigned int NLINES = 250000;
+  const unsigned int NCOLUMNS = 4;
+  const unsigned int WIDTH = 10;
+
+  // Reader and columns with the structure of Reader and Column
+  class Reader {
+    public:
+      virtual ~Reader() {}
+      virtual bool next_line() = 0;
+      virtual const char* get_buffer(unsigned int i) const = 0;
+      virtual unsigned int get_length(unsigned int i) const = 0;
+  };
+
+  template<typename Fields>
+  class FieldsReader : public Reader {
+    public:
+      FieldsReader(const std::vector<Fields>& columns) : 
+        columns_(columns), line_(-1) {}
+      bool next_line() { return ++line_ < static_cast<int>(NLINES);}
+      const char* get_buffer(unsigned int i) const { 
+        return columns_[i].buffer(line_);
+      }
+      unsigned int get_length(unsigned int i) const { 
+        return columns_[i].length(line_);
+      }
+    private:
+      std::vector<Fields> columns_;
+      int line_;
+  };
+
+  class Column {
+    public:
+      virtual ~Column() {}
+      virtual void assign() = 0;
+      virtual void next() = 0;
+  };
+
+  // As IntColumn and DoubleColumn before the conversion loops were used
+  template<typename Converter>
+  class ConverterColumn : public Column {
+    public:
+      typedef typename Converter::value_type value_type;
+      ConverterColumn(const Reader* reader, unsigned int column, 
+          const Converter& converter, value_type* result) : reader_(reader), 
+        column_(column), converter_(converter), p_(result) {}
+      void assign() {
+        const char* buffer = reader_->get_buffer(column_);
+        unsigned int length = reader_->get_length(column_);
+        if (!converter_(buffer, length, *p_)) *p_ = 0;
+      }
+      void next() { ++p_;}
+    private:
+      const Reader* reader_;
+      unsigned int column_;
+      Converter converter_;
+      value_type* p_;
+  };
+
+  // NCOLUMNS columns of NLINES fields of at most WIDTH characters; stored as
+  // stripes of WIDTH characters and as spans pointing into the stripes
+  struct Block {
+    std::vector<std::vector<char> > stripes;
+    std::vector<std::vector<FieldSpan> > spans;
+  };
+
+  Block generate(bool doubles) {
+    Block block;
+    block.stripes.resize(NCOLUMNS);
+    block.spans.resize(NCOLUMNS);
+    char buffer[64];
+    srand(1);
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+      std::vector<char>& stripe = block.stripes[i];
+      stripe.resize(NLINES*WIDTH);
+      for (unsigned int j = 0; j < NLINES; ++j) {
+        int length = doubles ? 
+          snprintf(buffer, sizeof(buffer), "%.*f", rand() % 4 + 1, (rand() % 100000)/7.0) :
+          snprintf(buffer, sizeof(buffer), "%d", rand() % 1000000);
+        std::fill(stripe.begin() + j*WIDTH, stripe.begin() + (j+1)*WIDTH, ' ');
+        std::copy(buffer, buffer + length, stripe.begin() + j*WIDTH);
+        FieldSpan span = {&stripe[j*WIDTH], static_cast<unsigned int>(length)};
+        block.spans[i].push_back(span);
+      }
+    }
+    return block;
+  }
+
+  std::vector<SpanFields> span_fields(const Block& block) {
+    std::vector<SpanFields> fields;
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) 
+      fields.push_back(SpanFields(&block.spans[i][0]));
+    return fields;
+  }
+
+  std::vector<StripeFields> stripe_fields(const Block& block) {
+    std::vector<StripeFields> fields;
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) 
+      fields.push_back(StripeFields(&block.stripes[i][0], WIDTH));
+    return fields;
+  }
+
+  template<typename T>
+  double sum(const std::vector<T>& values) {
+    double result = 0.0;
+    for (unsigned int i = 0; i < values.size(); ++i) result += values[i];
+    return result;
+  }
+
+  template<typename Converter, typename Fields>
+  double read_dispatch(const Converter& converter, 
+      const std::vector<Fields>& fields) {
+    typedef typename Converter::value_type value_type;
+    std::vector<value_type> result(NLINES*NCOLUMNS);
+    FieldsReader<Fields> reader(fields);
+    std::vector<Column*> columns;
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) 
+      columns.push_back(new ConverterColumn<Converter>(&reader, i, converter, 
+        &result[i*NLINES]));
+    while (reader.next_line()) {
+      for (std::vector<Column*>::iterator p = columns.begin(); 
+          p != columns.end(); ++p) {
+        (*p)->assign();
+        (*p)->next();
+      }
+    }
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) delete columns[i];
+    return sum(result);
+  }
+
+  template<typename Converter, typename Fields>
+  double read_kernel(const Converter& converter, 
+      const std::vector<Fields>& fields) {
+    typedef typename Converter::value_type value_type;
+    std::vector<value_type> result(NLINES*NCOLUMNS);
+    for (unsigned int i = 0; i < NCOLUMNS; ++i) 
+      convert_fields(converter, fields[i], 0, NLINES, &result[i*NLINES]);
+    return sum(result);
+  }
+
+  template<typename Converter, typename Fields>
+  void run(const char* name, const Converter& converter, 
+      const std::vector<Fields>& fields) {
+    double t_dispatch = time_per_call(NLINES*NCOLUMNS, 
+      [&]() { return read_dispatch(converter, fields); });
+    double t_kernel = time_per_call(NLINES*NCOLUMNS, 
+      [&]() { return read_kernel(converter, fields); });
+    printf("%-16s %14.1f %14.1f\n", name, t_dispatch, t_kernel);
+  }
+}
+
+int main() {
+  Block ints = generate(false);
+  Block doubles = generate(true);
+  printf("%-16s %14s %14s\n", "fields", "dispatch (ns)", "kernel (ns)");
+  run("int spans", IntConverter(0), span_fields(ints));
+  run("int stripes", IntConverter(0), stripe_fields(ints));
+  run("double spans", DoubleConverter(0.0), span_fields(doubles));
+  run("double stripes", DoubleConverter(0.0), stripe_fields(doubles));
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the lookup of the levels of categorical columns. Compares 
+// LevelDictionary with the std::map used up to LaF 0.8.6, for a few numbers 
+// of distinct levels.
+
+#include "leveldictionary.h"
+#include "conversion.h"
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+  const unsigned int NVALUES = 1000000;
+  const unsigned int WIDTH = 12;
+
+  // Fixed width fields of WIDTH characters containing one of nlevels levels
+  std::vector<char> generate(unsigned int nlevels) {
+    std::vector<char> fields(NVALUES*WIDTH);
+    char buffer[64];
+    srand(1);
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      snprintf(buffer, sizeof(buffer), "%-12s", 
+        ("level" + std::to_string(rand() % nlevels)).c_str());
+      std::copy(buffer, buffer + WIDTH, fields.begin() + i*WIDTH);
+    }
+    return fields;
+  }
+
+  // As FactorColumn::convert up to LaF 0.8.6
+  double lookup_map(const std::vector<char>& fields) {
+    std::map<std::string, int> levels;
+    double result = 0.0;
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      std::string value = chartostring(&fields[i*WIDTH], WIDTH, true);
+      if (levels[value] == 0) levels[value] = levels.size();
+      result += levels[value];
+    }
+    return result;
+  }
+
+  double lookup_dictionary(const std::vector<char>& fields) {
+    LevelDictionary levels;
+    double result = 0.0;
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      const char* buffer = &fields[i*WIDTH];
+      unsigned int length = WIDTH;
+      trim_blanks(buffer, length);
+      result += levels.add(buffer, length);
+    }
+    return result;
+  }
+}
+
+int main() {
+  const unsigned int nlevels[] = {2, 20, 500, 10000};
+  printf("%8s %12s %16s\n", "levels", "map (ns)", "dictionary (ns)");
+  for (unsigned int i = 0; i < sizeof(nlevels)/sizeof(nlevels[0]); ++i) {
+    std::vector<char> fields = generate(nlevels[i]);
+    double t_map = time_per_call(NVALUES, 
+      [&]() { return lookup_map(fields); });
+    double t_dictionary = time_per_call(NVALUES, 
+      [&]() { return lookup_dictionary(fields); });
+    printf("%8u %12.1f %16.1f\n", nlevels[i], t_map, t_dictionary);
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the conversion from string to double. Compares strtodouble 
+// with the implementation used up to LaF 0.8.6 for numbers in a few common 
+// formats. Also counts the number of results that differ from strtod (which 
+// is correctly rounded).
+
+#include "conversion.h"
+#include "conversion_old.h"
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+  const unsigned int NVALUES = 1000000;
+  const unsigned int WIDTH = 24;
+
+  // Fixed width fields of WIDTH characters 
+  std::vector<char> generate(const char* format, char dec) {
+    std::vector<char> fields(NVALUES*WIDTH, ' ');
+    char buffer[64];
+    srand(1);
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      double value = (rand() - RAND_MAX/2.0) / (rand() % 1000 + 1.0);
+      int n = snprintf(buffer, sizeof(buffer), format, value);
+      for (int j = 0; j < n && j < (int)WIDTH; ++j) 
+        fields[i*WIDTH + j] = buffer[j] == '.' ? dec : buffer[j];
+    }
+    return fields;
+  }
+
+  // Number of values that differ from the correctly rounded value
+  template<typename F>
+  unsigned int count_differences(const std::vector<char>& fields, char dec, 
+      F convert) {
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      std::string field(&fields[i*WIDTH], WIDTH);
+      for (std::string::iterator p = field.begin(); p != field.end(); ++p)
+        if (*p == dec) *p = '.';
+      if (convert(&fields[i*WIDTH], WIDTH, dec) != strtod(field.c_str(), 0)) n++;
+    }
+    return n;
+  }
+
+  template<typename F>
+  double sum(const std::vector<char>& fields, char dec, F convert) {
+    double result = 0.0;
+    for (unsigned int i = 0; i < NVALUES; ++i) 
+      result += convert(&fields[i*WIDTH], WIDTH, dec);
+    return result;
+  }
+
+  double convert_new(const char* str, unsigned int nchar, char dec) {
+    return strtodouble(str, nchar, dec);
+  }
+
+  double convert_old(const char* str, unsigned int nchar, char dec) {
+    return old::strtodouble(str, nchar, dec);
+  }
+}
+
+int main() {
+  const char* formats[] = {"%.0f", "%.2f", "%.6f", "%.15g", "%.17g", "%.10e"};
+  const char decs[] = {'.', ','};
+  printf("%-8s %-4s %12s %12s %10s %10s\n", "format", "dec", "old (ns)", 
+    "new (ns)", "old diff", "new diff");
+  for (unsigned int i = 0; i < sizeof(formats)/sizeof(formats[0]); ++i) {
+    for (unsigned int j = 0; j < sizeof(decs); ++j) {
+      std::vector<char> fields = generate(formats[i], decs[j]);
+      double t_old = time_per_call(NVALUES, 
+        [&]() { return sum(fields, decs[j], convert_old); });
+      double t_new = time_per_call(NVALUES, 
+        [&]() { return sum(fields, decs[j], convert_new); });
+      printf("%-8s '%c'  %12.1f %12.1f %10u %10u\n", formats[i], decs[j], 
+        t_old, t_new, count_differences(fields, decs[j], convert_old),
+        count_differences(fields, decs[j], convert_new));
+    }
+  }
+  return 0;
+}
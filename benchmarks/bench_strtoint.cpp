@@ -0,0 +1,84 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Benchmark of the conversion from string to int. Compares strtoint with the
+// implementation used up to LaF 0.8.6 for fixed width fields in a few common
+// layouts.
+
+#include "conversion.h"
+#include "conversion_old.h"
+#include "benchmark.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+  const unsigned int NVALUES = 1000000;
+  const unsigned int WIDTH = 12;
+  const unsigned int NROUNDS = 15;
+
+  // Fixed width fields of WIDTH characters
+  std::vector<char> generate(const char* format, int max) {
+    std::vector<char> fields(NVALUES*WIDTH);
+    char buffer[64];
+    srand(1);
+    for (unsigned int i = 0; i < NVALUES; ++i) {
+      int value = rand() % max - (max < 0 ? max/2 : 0);
+      snprintf(buffer, sizeof(buffer), format, value);
+      std::copy(buffer, buffer + WIDTH, fields.begin() + i*WIDTH);
+    }
+    return fields;
+  }
+
+  template<typename F>
+  double sum(const std::vector<char>& fields, F convert) {
+    double result = 0.0;
+    for (unsigned int i = 0; i < NVALUES; ++i) 
+      result += convert(&fields[i*WIDTH], WIDTH);
+    return result;
+  }
+
+  int convert_new(const char* str, unsigned int nchar) {
+    return strtoint(str, nchar);
+  }
+
+  int convert_old(const char* str, unsigned int nchar) {
+    return old::strtoint(str, nchar);
+  }
+}
+
+int main() {
+  // format and range of the values; negative ranges include negative values
+  const char* formats[] = {"%12d", "%-12d", "%012d", "%12d", "%12d"};
+  const int ranges[] = {1000000000, 1000000000, 100000, 100, -2000000};
+  printf("%-8s %12s %12s %12s\n", "format", "range", "old (ns)", "new (ns)");
+  for (unsigned int i = 0; i < sizeof(formats)/sizeof(formats[0]); ++i) {
+    std::vector<char> fields = generate(formats[i], ranges[i]);
+    // the implementations are timed alternately so that changes in the load 
+    // of the machine affect both
+    double t_old = 0.0, t_new = 0.0;
+    for (unsigned int r = 0; r < NROUNDS; ++r) {
+      double t = time_per_call(NVALUES, 
+        [&]() { return sum(fields, convert_old); }, 1);
+      if (r == 0 || t < t_old) t_old = t;
+      t = time_per_call(NVALUES, [&]() { return sum(fields, convert_new); }, 1);
+      if (r == 0 || t < t_new) t_new = t;
+    }
+    printf("%-8s %12d %12.1f %12.1f\n", formats[i], ranges[i], t_old, t_new);
+  }
+  return 0;
+}
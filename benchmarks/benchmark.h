@@ -0,0 +1,41 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef benchmark_h
+#define benchmark_h
+
+#include <algorithm>
+#include <chrono>
+
+// Calls f repeatedly and returns the fastest time in nanoseconds divided by
+// ncalls (the number of conversions performed by f). The result of f is 
+// accumulated to make sure the work is not optimised away.
+template<typename F>
+double time_per_call(unsigned int ncalls, F f, unsigned int repetitions = 5) {
+  static volatile double sink = 0.0;
+  double best = 0.0;
+  for (unsigned int i = 0; i < repetitions; ++i) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sink = sink + f();
+    std::chrono::duration<double, std::nano> elapsed = 
+      std::chrono::steady_clock::now() - start;
+    if (i == 0 || elapsed.count() < best) best = elapsed.count();
+  }
+  return best / ncalls;
+}
+
+#endif
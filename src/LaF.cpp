@@ -16,9 +16,14 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "LaF.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 
 RcppExport SEXP laf_open_csv(SEXP r_filename, SEXP r_types, SEXP r_sep, 
-    SEXP r_dec, SEXP r_trim, SEXP r_skip, SEXP r_ignore_failed_conversion) {
+    SEXP r_dec, SEXP r_trim, SEXP r_skip, SEXP r_ignore_failed_conversion,
+    SEXP r_mmap, SEXP r_index, SEXP r_threads, SEXP r_read_ahead) {
 BEGIN_RCPP
   Rcpp::CharacterVector filenamev(r_filename);
   Rcpp::IntegerVector types(r_types);
@@ -33,11 +38,22 @@ BEGIN_RCPP
   unsigned int skip = static_cast<unsigned int>(skipv[0]);
   Rcpp::LogicalVector ignore_failed_conversionv(r_ignore_failed_conversion);
   bool ignore_failed_conversion = static_cast<bool>(ignore_failed_conversionv[0]);
+  Rcpp::LogicalVector mmapv(r_mmap);
+  bool use_mmap = static_cast<bool>(mmapv[0]);
+  Rcpp::CharacterVector indexv(r_index);
+  std::string index_filename = static_cast<char*>(indexv[0]);
+  Rcpp::IntegerVector threadsv(r_threads);
+  unsigned int threads = static_cast<unsigned int>(threadsv[0]);
+  Rcpp::IntegerVector read_aheadv(r_read_ahead);
+  unsigned int read_ahead = static_cast<unsigned int>(read_aheadv[0]);
   Rcpp::IntegerVector p = Rcpp::IntegerVector::create(1);
-  CSVReader* reader = new CSVReader(filename, sep, skip);
+  CSVReader* reader = new CSVReader(filename, sep, skip, 1E5, use_mmap, 
+    read_ahead);
+  reader->set_index_filename(index_filename);
   reader->set_decimal_seperator(dec);
   reader->set_trim(trim);
   reader->set_ignore_failed_conversion(ignore_failed_conversion);
+  reader->set_threads(threads);
   for (int i = 0; i < types.size(); ++i) {
     if (types[i] == 0) {
       reader->add_double_column();
@@ -55,7 +71,8 @@ END_RCPP
 }
 
 RcppExport SEXP laf_open_fwf(SEXP r_filename, SEXP r_types, SEXP r_widths, 
-    SEXP r_dec, SEXP r_trim, SEXP r_ignore_failed_conversion) {
+    SEXP r_dec, SEXP r_trim, SEXP r_ignore_failed_conversion, SEXP r_mmap,
+    SEXP r_threads, SEXP r_read_ahead) {
 BEGIN_RCPP
   Rcpp::CharacterVector filenamev(r_filename);
   Rcpp::IntegerVector types(r_types);
@@ -67,8 +84,15 @@ BEGIN_RCPP
   bool trim = static_cast<bool>(trimv[0]);
   Rcpp::LogicalVector ignore_failed_conversionv(r_ignore_failed_conversion);
   bool ignore_failed_conversion = static_cast<bool>(ignore_failed_conversionv[0]);
+  Rcpp::LogicalVector mmapv(r_mmap);
+  bool use_mmap = static_cast<bool>(mmapv[0]);
+  Rcpp::IntegerVector threadsv(r_threads);
+  unsigned int threads = static_cast<unsigned int>(threadsv[0]);
+  Rcpp::IntegerVector read_aheadv(r_read_ahead);
+  unsigned int read_ahead = static_cast<unsigned int>(read_aheadv[0]);
   Rcpp::IntegerVector p = Rcpp::IntegerVector::create(1);
-  FWFReader* reader = new FWFReader(filename);
+  FWFReader* reader = new FWFReader(filename, 1024, 0, use_mmap, read_ahead);
+  reader->set_threads(threads);
   reader->set_decimal_seperator(dec);
   reader->set_trim(trim);
   reader->set_ignore_failed_conversion(ignore_failed_conversion);
@@ -109,8 +133,10 @@ END_RCPP
 RcppExport SEXP laf_goto_line(SEXP p, SEXP r_line) {
 BEGIN_RCPP
   Rcpp::IntegerVector pv(p);
-  Rcpp::IntegerVector line(r_line);
-  unsigned int l = static_cast<unsigned int>(line[0]);
+  Rcpp::NumericVector line(r_line);
+  if (!R_FINITE(line[0]) || line[0] < 1) 
+    throw std::runtime_error("Line number should be finite and positive.");
+  uint64_t l = static_cast<uint64_t>(line[0]);
   Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
   if (reader) {
     if (l == 1) {
@@ -127,9 +153,9 @@ RcppExport SEXP laf_nrow(SEXP p) {
 BEGIN_RCPP
   Rcpp::IntegerVector pv(p);
   Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
-  int nrow = 0;
+  double nrow = 0;
   if (reader) { 
-    nrow = static_cast<int>(reader->nlines());
+    nrow = static_cast<double>(reader->nlines());
   }
   // close up
   Rcpp::NumericVector r_nrow(1);
@@ -142,9 +168,9 @@ RcppExport SEXP laf_current_line(SEXP p) {
 BEGIN_RCPP
   Rcpp::IntegerVector pv(p);
   Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
-  unsigned int current_line = 0;
+  double current_line = 0;
   if (reader) { 
-    current_line = static_cast<int>(reader->get_current_line());
+    current_line = static_cast<double>(reader->get_current_line());
   }
   // close up
   Rcpp::NumericVector r_current_line(1);
@@ -153,7 +179,8 @@ BEGIN_RCPP
 END_RCPP
 }
 
-RcppExport SEXP laf_next_block(SEXP p, SEXP r_nlines, SEXP r_columns, SEXP r_result) {
+RcppExport SEXP laf_next_block(SEXP p, SEXP r_nlines, SEXP r_columns, SEXP r_result,
+    SEXP r_filter) {
 BEGIN_RCPP
   // transform from SEXP-types to Rcpp-types
   Rcpp::IntegerVector pv(p);
@@ -166,20 +193,41 @@ BEGIN_RCPP
   Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
   if (reader) {
     // initialize columns
+    std::vector<Column*> block_columns;
+    std::vector<unsigned int> used_columns;
     for (unsigned int i = 0; i < ncolumns; ++i) {
       Column* column = reader->get_column(columns[i]);
       column->init(result[i]);
+      block_columns.push_back(column);
+      used_columns.push_back(columns[i]);
     }
-    // start reading
-    while (reader->next_line()) {
-      for (unsigned int i = 0; i < ncolumns; ++i) {
-        Column* column = reader->get_column(columns[i]);
-	column->assign();
-	column->next();
+    // initialize filter; r_filter is either NULL or a list with the columns, 
+    // operators and values of the conditions
+    Filter filter;
+    if (!Rf_isNull(r_filter)) {
+      Rcpp::List filterv(r_filter);
+      Rcpp::IntegerVector filter_columns(filterv[0]);
+      Rcpp::IntegerVector filter_operators(filterv[1]);
+      Rcpp::List filter_values(filterv[2]);
+      for (int i = 0; i < filter_columns.size(); ++i) {
+        const Column* column = reader->get_column(filter_columns[i]);
+        Filter::Operator op = static_cast<Filter::Operator>(filter_operators[i]);
+        SEXP values = filter_values[i];
+        if (Rf_isString(values)) {
+          filter.add_condition(column, op, 
+            Rcpp::as<std::vector<std::string> >(values));
+        } else {
+          filter.add_condition(column, op, 
+            Rcpp::as<std::vector<double> >(values));
+        }
       }
-      ++nread;
-      if (nread >= nlines) break;
+      std::vector<unsigned int> filter_used = filter.get_columns();
+      used_columns.insert(used_columns.end(), filter_used.begin(), filter_used.end());
     }
+    reader->set_used_columns(used_columns);
+    // start reading
+    if (nlines > 0) nread = reader->read_block(block_columns, nlines, &filter);
+    for (unsigned int i = 0; i < ncolumns; ++i) block_columns[i]->finish();
   }
   // close up
   Rcpp::NumericVector r_nread(1);
@@ -193,44 +241,58 @@ BEGIN_RCPP
   // transform from SEXP-types to Rcpp-types
   Rcpp::IntegerVector pv(p);
   Rcpp::IntegerVector columns(r_columns);
-  Rcpp::IntegerVector lines(r_lines);
+  Rcpp::NumericVector lines(r_lines);
   unsigned int ncolumns = columns.size();
   unsigned int nlines = lines.size();
   Rcpp::DataFrame result(r_result);
-  int nread = 0;
+  Rcpp::LogicalVector found(nlines);
+  std::fill(found.begin(), found.end(), false);
   // get reader
   Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
   if (reader) {
     // initialize columns
+    std::vector<unsigned int> used_columns;
     for (unsigned int i = 0; i < ncolumns; ++i) {
       Column* column = reader->get_column(columns[i]);
       column->init(result[i]);
+      used_columns.push_back(columns[i]);
     }
-    // start reading
+    reader->set_used_columns(used_columns);
+    // read the lines in sorted order, reading each line once, and assign the
+    // values to the elements of the result requesting that line
+    std::vector< std::pair<uint64_t, unsigned int> > order(nlines);
     for (unsigned int i = 0; i < nlines; ++i) {
-      if (static_cast<unsigned int>(lines[i]) == reader->get_current_line()-1) {
-        if (reader->next_line()) {
-          for (unsigned int j = 0; j < ncolumns; ++j) {
-            Column* column = reader->get_column(columns[j]);
-            column->assign();
-            column->next();
-          }
-          ++nread;
-        }
-      } else if (reader->goto_line(lines[i])) {
+      // converting a missing, infinite or negative value to an integer is
+      // undefined
+      if (!R_FINITE(lines[i]) || lines[i] < 0) 
+        throw std::runtime_error("Line numbers should be finite and positive.");
+      order[i] = std::make_pair(static_cast<uint64_t>(lines[i]), i);
+    }
+    std::sort(order.begin(), order.end());
+    for (unsigned int i = 0; i < nlines; ) {
+      uint64_t line = order[i].first;
+      unsigned int end = i + 1;
+      while (end < nlines && order[end].first == line) ++end;
+      bool ok = (line == reader->get_current_line()-1) ? 
+        reader->next_line() : reader->goto_line(line);
+      if (ok) {
         for (unsigned int j = 0; j < ncolumns; ++j) {
           Column* column = reader->get_column(columns[j]);
-          column->assign();
-          column->next();
+          const char* buffer = reader->get_buffer(columns[j]);
+          unsigned int length = reader->get_length(columns[j]);
+          for (unsigned int k = i; k < end; ++k)
+            column->assign_at(order[k].second, buffer, length, line + 1);
         }
-        ++nread;
+        for (unsigned int k = i; k < end; ++k) found[order[k].second] = true;
       }
+      i = end;
     }
+    for (unsigned int j = 0; j < ncolumns; ++j) 
+      reader->get_column(columns[j])->finish();
   }
-  // close up
-  Rcpp::NumericVector r_nread(1);
-  r_nread[0] = nread;
-  return r_nread;
+  // close up; lines that were not found still need to be removed from the
+  // result
+  return found;
 END_RCPP
 }
 
@@ -244,10 +306,10 @@ BEGIN_RCPP
   if (reader) {
     const FactorColumn* factor = dynamic_cast<const FactorColumn*>(reader->get_column(column[0]));
     if (factor) {
-      const std::map<std::string, int>& levels_map = factor->get_levels();
-      for (std::map<std::string, int>::const_iterator p = levels_map.begin(); p != levels_map.end(); ++p) {
-        labels.push_back(p->first);
-        levels.push_back(p->second);
+      const LevelDictionary& dictionary = factor->get_levels();
+      for (unsigned int code = 1; code <= dictionary.size(); ++code) {
+        labels.push_back(dictionary.get_level(code));
+        levels.push_back(code);
       }
     }
   }
@@ -256,3 +318,78 @@ BEGIN_RCPP
 END_RCPP
 }
 
+RcppExport SEXP laf_set_levels(SEXP p, SEXP r_column, SEXP r_levels, 
+    SEXP r_unknown_to_na) {
+BEGIN_RCPP
+  Rcpp::IntegerVector pv(p);
+  Rcpp::IntegerVector column(r_column);
+  Rcpp::CharacterVector levels(r_levels);
+  bool unknown_to_na = Rcpp::LogicalVector(r_unknown_to_na)[0];
+  Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
+  if (reader) {
+    FactorColumn* factor = dynamic_cast<FactorColumn*>(reader->get_column(column[0]));
+    if (!factor) throw std::runtime_error("Column is not a categorical column.");
+    // the levels are numbered in the order given
+    std::shared_ptr<LevelDictionary> dictionary(new LevelDictionary());
+    for (int i = 0; i < levels.size(); ++i) {
+      std::string level = static_cast<char*>(levels[i]);
+      dictionary->add(level.data(), level.size());
+    }
+    factor->set_levels(dictionary);
+    factor->set_unknown_to_na(unknown_to_na);
+  }
+  return pv;
+END_RCPP
+}
+
+RcppExport SEXP laf_share_levels(SEXP p, SEXP r_column, SEXP p_from, 
+    SEXP r_column_from, SEXP r_unknown_to_na) {
+BEGIN_RCPP
+  Rcpp::IntegerVector pv(p);
+  Rcpp::IntegerVector column(r_column);
+  Rcpp::IntegerVector pv_from(p_from);
+  Rcpp::IntegerVector column_from(r_column_from);
+  bool unknown_to_na = Rcpp::LogicalVector(r_unknown_to_na)[0];
+  Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
+  Reader* reader_from = ReaderManager::instance()->get_reader(pv_from[0]);
+  if (!reader_from) throw std::runtime_error("Connection has been closed.");
+  if (reader) {
+    FactorColumn* factor = dynamic_cast<FactorColumn*>(reader->get_column(column[0]));
+    const FactorColumn* factor_from = dynamic_cast<const FactorColumn*>(
+      reader_from->get_column(column_from[0]));
+    if (!factor || !factor_from) 
+      throw std::runtime_error("Column is not a categorical column.");
+    factor->set_levels(factor_from->get_shared_levels());
+    factor->set_unknown_to_na(unknown_to_na);
+  }
+  return pv;
+END_RCPP
+}
+
+RcppExport SEXP laf_conversion_errors(SEXP p, SEXP r_clear) {
+BEGIN_RCPP
+  Rcpp::IntegerVector pv(p);
+  bool clear = Rcpp::LogicalVector(r_clear)[0];
+  Reader* reader = ReaderManager::instance()->get_reader(pv[0]);
+  double count = 0;
+  std::vector<double> lines;
+  std::vector<int> columns;
+  std::vector<std::string> values;
+  if (reader) {
+    ConversionLog& log = reader->get_conversion_log();
+    count = static_cast<double>(log.count());
+    std::vector<ConversionLog::Entry> entries = log.get_entries();
+    for (std::vector<ConversionLog::Entry>::const_iterator e = entries.begin();
+        e != entries.end(); ++e) {
+      lines.push_back(static_cast<double>(e->line));
+      columns.push_back(e->column + 1);
+      values.push_back(e->value);
+    }
+    if (clear) log.clear();
+  }
+  return Rcpp::List::create(Rcpp::Named("count") = count,
+    Rcpp::Named("line") = Rcpp::wrap(lines),
+    Rcpp::Named("column") = Rcpp::wrap(columns),
+    Rcpp::Named("value") = Rcpp::wrap(values));
+END_RCPP
+}
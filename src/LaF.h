@@ -17,27 +17,36 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "csvreader.h"
 #include "fwfreader.h"
+#include "filter.h"
 #include "readermanager.h"
 #include <Rcpp.h>
   
 extern "C" {
   SEXP laf_open_csv(SEXP r_filename, SEXP r_types, SEXP r_sep, SEXP r_dec, 
-    SEXP r_trim, SEXP r_skip, SEXP r_ignore_failed_conversion);
+    SEXP r_trim, SEXP r_skip, SEXP r_ignore_failed_conversion, SEXP r_mmap,
+    SEXP r_index, SEXP r_threads, SEXP r_read_ahead);
   SEXP laf_open_fwf(SEXP r_filename, SEXP r_types, SEXP r_widths, SEXP r_dec,
-    SEXP r_trim, SEXP r_ignore_failed_conversion);
+    SEXP r_trim, SEXP r_ignore_failed_conversion, SEXP r_mmap, 
+    SEXP r_threads, SEXP r_read_ahead);
   SEXP laf_close(SEXP p);
   SEXP laf_reset(SEXP p);
   SEXP laf_goto_line(SEXP p, SEXP r_line);
   SEXP laf_nrow(SEXP p);
   SEXP laf_current_line(SEXP p);
-  SEXP laf_next_block(SEXP p, SEXP r_nlines, SEXP r_columns, SEXP r_result);
+  SEXP laf_next_block(SEXP p, SEXP r_nlines, SEXP r_columns, SEXP r_result,
+    SEXP r_filter);
   SEXP laf_read_lines(SEXP p, SEXP r_lines, SEXP r_columns, SEXP r_result);
   SEXP laf_levels(SEXP p, SEXP r_column);
+  SEXP laf_set_levels(SEXP p, SEXP r_column, SEXP r_levels, 
+    SEXP r_unknown_to_na);
+  SEXP laf_share_levels(SEXP p, SEXP r_column, SEXP p_from, 
+    SEXP r_column_from, SEXP r_unknown_to_na);
+  SEXP laf_conversion_errors(SEXP p, SEXP r_clear);
   SEXP colsum(SEXP p, SEXP r_columns);
   SEXP colfreq(SEXP p, SEXP r_columns);
   SEXP colrange(SEXP p, SEXP r_columns);
   SEXP colnmissing(SEXP p, SEXP r_columns);
-  SEXP nlines(SEXP r_filename);
+  SEXP nlines(SEXP r_filename, SEXP r_threads);
   SEXP r_get_line(SEXP r_filename, SEXP r_line_numbers);
 }
 
@@ -16,6 +16,9 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "column.h"
+#include "reader.h"
+#include <sstream>
+#include <stdexcept>
 
 Column::Column(const Reader* reader, unsigned int column, 
     bool ignore_failed_conversion) :
@@ -27,3 +30,27 @@ Column::Column(const Reader* reader, unsigned int column,
 Column::~Column() {
 }
 
+void Column::assign_stripe(unsigned int i, const char* stripe, 
+    unsigned int width, unsigned int n, uint64_t line) {
+  for (unsigned int j = 0; j < n; ++j, stripe += width) 
+    assign_at(i + j, stripe, width, line + j);
+}
+
+void Column::assign_spans(unsigned int i, const FieldSpan* spans, 
+    unsigned int n, uint64_t line) {
+  for (unsigned int j = 0; j < n; ++j) 
+    assign_at(i + j, spans[j].buffer, spans[j].length, line + j);
+}
+
+void Column::conversion_failed(const char* buffer, unsigned int length, 
+    uint64_t line, const char* type) const {
+  if (ignore_failed_conversion_) {
+    reader_->get_conversion_log().add(line, column_, buffer, length);
+    return;
+  }
+  std::ostringstream message;
+  message << "Conversion to " << type << " failed; line=" << line
+    << "; column=" << (column_ + 1L)
+    << "; string='" << std::string(buffer, length) << "'";
+  throw std::runtime_error(message.str());
+}
@@ -18,7 +18,9 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef column_h
 #define column_h
 
+#include "conversion.h"
 #include <Rcpp.h>
+#include <stdint.h>
 
 class Reader;
 
@@ -31,12 +33,51 @@ class Column
 
     virtual double get_double() const = 0; 
     virtual int get_int() const = 0; 
+    // Convert the value in buffer instead of the value of the current line
+    // of the reader. line is only used in error messages.
+    virtual double get_double(const char* buffer, unsigned int length, 
+      uint64_t line) const = 0;
+    virtual int get_int(const char* buffer, unsigned int length, 
+      uint64_t line) const = 0;
 
     virtual void assign() = 0;
     virtual void init(Rcpp::List::Proxy proxy) = 0;
     virtual void next() = 0;
+    // Called when all values have been assigned to the vector passed to 
+    // init; e.g. to set attributes of the vector.
+    virtual void finish() {}
+
+    // Assign the value in buffer to the i-th element after the current
+    // element. Used when reading blocks of lines in parallel; in that case the
+    // buffer is not obtained from the reader. line is only used in error
+    // messages.
+    virtual void assign_at(unsigned int i, const char* buffer, 
+      unsigned int length, uint64_t line) = 0;
+    // Assign n values to the elements i, i+1, ... after the current element.
+    // The values are stored consecutively in stripe; each value consists of
+    // width bytes. line is the line of the first value. Columns can override
+    // this to convert the values in one loop. 
+    virtual void assign_stripe(unsigned int i, const char* stripe, 
+      unsigned int width, unsigned int n, uint64_t line);
+    // Assign n values to the elements i, i+1, ... after the current element.
+    // spans[j] is the field on line line + j. Columns can override this to
+    // convert the values in one loop.
+    virtual void assign_spans(unsigned int i, const FieldSpan* spans, 
+      unsigned int n, uint64_t line);
+    // When true, assign_at can be called simultaneously from different
+    // threads (for different i). The same holds for get_double and get_int
+    // with a buffer.
+    virtual bool thread_safe() const { return false;}
+
+    unsigned int get_column_number() const { return column_;}
 
   protected:
+    // Handle a field that could not be converted to type. When failed
+    // conversions are ignored the failure is added to the conversion log of
+    // the reader; otherwise an exception is thrown.
+    void conversion_failed(const char* buffer, unsigned int length, 
+      uint64_t line, const char* type) const;
+
     const Reader* reader_;
     unsigned int column_;
     bool ignore_failed_conversion_;
@@ -1,51 +1,161 @@
 #include "conversion.h"
-#include <cmath>
-
-inline int chartoint(char c) {
-  switch (c) {
-    case '0': return 0;
-    case '1': return 1;
-    case '2': return 2;
-    case '3': return 3;
-    case '4': return 4;
-    case '5': return 5;
-    case '6': return 6;
-    case '7': return 7;
-    case '8': return 8;
-    case '9': return 9;
-    default : throw ConversionError();
+#include "powersoffive.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// ============================================================================
+// ===                  CONVERSION FROM STRING TO INT                      ====
+// ============================================================================
+
+namespace {
+  // SWAR (SIMD within a register): eight characters are loaded into a 64 bit
+  // integer and handled at once. This requires a little endian byte order 
+  // (the first character in the lowest byte); otherwise the characters are 
+  // handled one at a time.
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || \
+    defined(_WIN32)
+  const bool SWAR = true;
+#else
+  const bool SWAR = false;
+#endif
+  const uint64_t BLANKS8 = 0x2020202020202020ULL;
+  const uint64_t LOW_NIBBLES8 = 0x0F0F0F0F0F0F0F0FULL;
+  const uint64_t HIGH_NIBBLES8 = 0xF0F0F0F0F0F0F0F0ULL;
+
+  inline int leading_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    for (uint64_t bit = 1ULL << 63; !(x & bit); bit >>= 1) ++n;
+    return n;
+#endif
   }
-}
 
-int strtoint(const char* str, unsigned int nchar) {
-  if (nchar < 1) throw ConversionError();
-  const char* c = str + (nchar-1);
-  int n = 1;
-  int result = 0;
-  int sign = 1;
-  bool rtrim = true;
-  bool ltrim = false;
-  for (unsigned int i = 0; i < nchar; ++i, --c) {
-    if (*c == ' ') {
-      if (!rtrim) ltrim = true;
-    } else if (*c == '-') {
-      if (rtrim | ltrim) throw ConversionError();
-      sign = -1;
-      ltrim = true;
-      rtrim = false;
-    } else if (*c == '+') {
-      if (rtrim | ltrim) throw ConversionError();
-      ltrim = true;
-      rtrim = false;
+  inline int trailing_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for (uint64_t bit = 1; !(x & bit); bit <<= 1) ++n;
+    return n;
+#endif
+  }
+
+  inline uint64_t load8(const char* str) {
+    uint64_t x;
+    std::memcpy(&x, str, sizeof(x));
+    return x;
+  }
+
+  // Bytes of x that are not a digit are non-zero in the result: either the 
+  // upper nibble is not 3 or the lower nibble is larger than 9 (adding 6 
+  // carries into the upper nibble). 
+  inline uint64_t non_digits8(uint64_t x) {
+    return ((x ^ 0x3030303030303030ULL) & HIGH_NIBBLES8) | 
+      (((x & LOW_NIBBLES8) + 0x0606060606060606ULL) & HIGH_NIBBLES8);
+  }
+
+  // Value of eight digits; combines pairs of digits, then pairs of two digit 
+  // numbers and finally pairs of four digit numbers. Bytes that are zero act
+  // as leading zeros.
+  inline uint64_t value8(uint64_t x) {
+    x = ((x & LOW_NIBBLES8) * 2561) >> 8;
+    x = ((x & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return ((x & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+  }
+
+  // Load the (at most eight) characters in [c, end) of the field [begin, end);
+  // missing characters are zero. Returns false when the characters can not be
+  // loaded at once (the field is shorter than eight characters).
+  inline bool load_upto8(const char* c, const char* begin, const char* end, 
+      uint64_t& x) {
+    if (end - c >= 8) {
+      x = load8(c);
+    } else if (end - begin >= 8) {
+      // load the last eight characters of the field and shift out the 
+      // characters before c
+      x = load8(end - 8) >> (8*(8 - (end - c)));
     } else {
-      if (ltrim) throw ConversionError();
-      result += n*chartoint(*c);
-      n *= 10;
-      rtrim = false;
+      return false;
+    }
+    return true;
+  }
+
+  inline const char* skip_blanks(const char* c, const char* begin, 
+      const char* end) {
+    uint64_t x;
+    while (SWAR && c < end && load_upto8(c, begin, end, x)) {
+      uint64_t non_blanks = x ^ BLANKS8;
+      if (non_blanks) return std::min(c + trailing_zeros(non_blanks)/8, end);
+      c += 8;
     }
+    while (c < end && *c == ' ') ++c;
+    return c;
+  }
+
+  // Parse an integer: optional blanks, an optional sign directly followed by
+  // digits and optional blanks. Values larger than max are stored as 
+  // max + 1 (max should be less than 2^32). Returns false when str is not an
+  // integer.
+  inline bool parse_integer(const char* str, unsigned int nchar, uint64_t max, 
+      bool& negative, uint64_t& value) {
+    const char* end = str + nchar;
+    const char* c = skip_blanks(str, str, end);
+    negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+      negative = *c == '-';
+      ++c;
+    }
+    const char* digits = c;
+    value = 0;
+    // eight digits at a time. After a complete group at most a few digits 
+    // remain, which are faster converted one at a time; numbers shorter than
+    // eight digits are converted as an incomplete group of which the digits
+    // are shifted to the end of the group.
+    uint64_t x;
+    while (SWAR && end - c >= 8 && !non_digits8(x = load8(c))) {
+      value = value*100000000 + value8(x);
+      if (value > max) value = max + 1;
+      c += 8;
+    }
+    if (SWAR && c == digits && c < end && load_upto8(c, str, end, x)) {
+      uint64_t non_digits = non_digits8(x);
+      unsigned int n = non_digits ? trailing_zeros(non_digits)/8 : 8;
+      if (n > 0) value = value8(x << (8*(8 - n)));
+      if (value > max) value = max + 1;
+      c += n;
+    }
+    for (; c < end; ++c) {
+      unsigned int d = static_cast<unsigned char>(*c) - '0';
+      if (d > 9) break;
+      value = value*10 + d;
+      if (value > max) value = max + 1;
+    }
+    if (c == digits) return false;
+    return skip_blanks(c, str, end) == end;
   }
-  if (n == 1) throw ConversionError();
-  return sign*result;
+}
+
+bool parse_int(const char* str, unsigned int nchar, int& result) {
+  bool negative = false;
+  uint64_t value = 0;
+  // INT_MIN is not accepted as it is used to represent missing values in R
+  if (!parse_integer(str, nchar, INT_MAX, negative, value) || value > INT_MAX) 
+    return false;
+  result = negative ? -static_cast<int>(value) : static_cast<int>(value);
+  return true;
+}
+
+int strtoint(const char* str, unsigned int nchar) {
+  int result = 0;
+  if (!parse_int(str, nchar, result)) throw ConversionError();
+  return result;
 }
 
 bool all_chars_equal(const char* str, unsigned int n, char c) {
@@ -59,117 +169,276 @@ bool all_chars_equal(const char* str, unsigned int n, char c) {
 // ===                 CONVERSION FROM STRING TO DOUBLE                    ====
 // ============================================================================
 
-inline double read_sign(const char** c, unsigned int* i, unsigned int nchar) {
-  for (; *i < nchar; ++*i, ++*c) {
-    if (**c == '-') {
-      ++*c; ++*i;
-      return -1.0;
+namespace {
+  // Number of significant digits accumulated in the 64 bit mantissa; 
+  // 10^19 < 2^64
+  const int MAX_DIGITS = 19;
+  // Integers up to 2^53 are exactly representable as double
+  const uint64_t MAX_EXACT_INTEGER = 9007199254740992ULL;
+  // Powers of ten that are exactly representable as double
+  const int MAX_EXACT_POWER = 22;
+  const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+    1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  // Exponents are limited to this value; larger exponents over- or underflow
+  // anyway
+  const int MAX_EXPONENT = 100000;
+  // The fast path requires that double arithmetic is not performed with 
+  // extended precision (e.g. by the x87 FPU)
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1)
+  const bool EXACT_DOUBLE_ARITHMETIC = true;
+#else
+  const bool EXACT_DOUBLE_ARITHMETIC = false;
+#endif
+
+  // Binary64: number of explicit bits of the mantissa, the exponent bias and
+  // the biased exponent of infinity
+  const int MANTISSA_BITS = 52;
+  const int EXPONENT_BIAS = 1023;
+  const int INFINITE_POWER = 0x7FF;
+
+  // 128 bit product of a and b
+  inline void multiply(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low) {
+#if defined(__SIZEOF_INT128__)
+    // __extension__ prevents a warning about __int128 with -pedantic
+    __extension__ typedef unsigned __int128 uint128;
+    uint128 r = static_cast<uint128>(a) * b;
+    high = static_cast<uint64_t>(r >> 64);
+    low = static_cast<uint64_t>(r);
+#else
+    uint64_t a_lo = a & 0xFFFFFFFFULL, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFFULL, b_hi = b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFULL) + lo_hi;
+    high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    low = (cross << 32) | (lo_lo & 0xFFFFFFFFULL);
+#endif
+  }
+
+  // Eisel-Lemire algorithm: computes the double nearest to w * 10^q (w > 0)
+  // using the 128 bit approximation of 5^q. Returns false in the (very rare)
+  // cases in which the approximation is not accurate enough to determine 
+  // the correctly rounded result.
+  bool eisel_lemire(uint64_t w, int q, double& result) {
+    uint64_t bits = 0;
+    if (q < SMALLEST_POWER_OF_FIVE) {
+      // w * 10^q is smaller than half of the smallest subnormal number
+      bits = 0;
+    } else if (q > LARGEST_POWER_OF_FIVE) {
+      bits = static_cast<uint64_t>(INFINITE_POWER) << MANTISSA_BITS;
+    } else {
+      int lz = leading_zeros(w);
+      w <<= lz;
+      // product of the normalised w and 5^q; when the bits below the 55 most
+      // significant bits of high are all ones, the second part of 5^q can
+      // change the result
+      const uint64_t* power = POWERS_OF_FIVE_128 + 2*(q - SMALLEST_POWER_OF_FIVE);
+      uint64_t high, low;
+      multiply(w, power[0], high, low);
+      const uint64_t precision_mask = 0xFFFFFFFFFFFFFFFFULL >> (MANTISSA_BITS + 3);
+      if ((high & precision_mask) == precision_mask) {
+        uint64_t high2, low2;
+        multiply(w, power[1], high2, low2);
+        low += high2;
+        if (high2 > low) high++;
+        if (low == 0xFFFFFFFFFFFFFFFFULL && (q < -27 || q > 55)) return false;
+      }
+      int upperbit = static_cast<int>(high >> 63);
+      int shift = upperbit + 64 - MANTISSA_BITS - 3;
+      uint64_t mantissa = high >> shift;
+      // binary exponent: floor(log2(10^q)) = floor(q * log2(10)) 
+      int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 
+        EXPONENT_BIAS;
+      if (power2 <= 0) {
+        // subnormal number
+        if (-power2 + 1 >= 64) {
+          mantissa = 0;
+          power2 = 0;
+        } else {
+          mantissa >>= -power2 + 1;
+          mantissa += mantissa & 1;
+          mantissa >>= 1;
+          power2 = mantissa < (1ULL << MANTISSA_BITS) ? 0 : 1;
+        }
+      } else {
+        // exactly halfway between two doubles; round to even. This can only
+        // happen for small q.
+        if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 &&
+            (mantissa << shift) == high) mantissa &= ~1ULL;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        if (mantissa >= (2ULL << MANTISSA_BITS)) {
+          mantissa = 1ULL << MANTISSA_BITS;
+          power2++;
+        }
+        mantissa &= ~(1ULL << MANTISSA_BITS);
+        if (power2 >= INFINITE_POWER) {
+          power2 = INFINITE_POWER;
+          mantissa = 0;
+        }
+      }
+      bits = mantissa | (static_cast<uint64_t>(power2) << MANTISSA_BITS);
     }
-    if (**c != ' ') return 1.0;
+    std::memcpy(&result, &bits, sizeof(result));
+    return true;
   }
-  throw ConversionError();
-} 
 
-void check_remainder(const char** c, unsigned int* i, unsigned int nchar) {
-  for (; *i < nchar; ++*i, ++*c) {
-    if (**c != ' ') throw ConversionError();
+  // Slow path: convert the mantissa [begin, end) and exponent using strtod. 
+  // The number is rewritten with a '.' as decimal separator as strtod 
+  // expects.
+  double strtod_fallback(const char* begin, const char* end, char dec, 
+      int exponent) {
+    std::string number(begin, end);
+    for (std::string::iterator p = number.begin(); p != number.end(); ++p) 
+      if (*p == dec) *p = '.';
+    char e[16];
+    std::snprintf(e, sizeof(e), "e%d", exponent);
+    number += e;
+    return std::strtod(number.c_str(), 0);
   }
 }
 
-inline int read_before_decimal(double* part1, const char** c, unsigned int* i, unsigned int nchar, char dec) {
-  double n1 = 1.0;
-  double result1 = 0.0;
-  int result = 0;
-  for (; *i < nchar; ++*i, ++*c) {
-    if (**c == dec) {
-      ++*c; ++*i;
-      result = 1;
-      break;
-    }
-    if (**c == 'E' || **c == 'e') {
-      ++*c; ++*i;
-      result = 2;
-      break;
+bool parse_double(const char* str, unsigned int nchar, double& result, 
+    char dec) {
+  const char* c = str;
+  const char* end = str + nchar;
+  // leading blanks and sign
+  while (c < end && *c == ' ') ++c;
+  if (c == end) return false;
+  bool negative = *c == '-';
+  if (negative) ++c;
+  // mantissa; the first MAX_DIGITS significant digits are stored in mantissa;
+  // the value of the number is mantissa * 10^exponent
+  const char* begin = c;
+  uint64_t mantissa = 0;
+  int ndigits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  for (; c < end; ++c) {
+    unsigned int d = static_cast<unsigned char>(*c) - '0';
+    if (d > 9) break;
+    if (ndigits < MAX_DIGITS) {
+      mantissa = 10*mantissa + d;
+      if (mantissa) ++ndigits;
+    } else {
+      exponent++;
+      truncated |= d != 0;
     }
-    if (**c == ' ') {
-      check_remainder(c, i, nchar);
-      break;
+  }
+  if (c < end && *c == dec) {
+    for (++c; c < end; ++c) {
+      unsigned int d = static_cast<unsigned char>(*c) - '0';
+      if (d > 9) break;
+      if (ndigits < MAX_DIGITS) {
+        mantissa = 10*mantissa + d;
+        if (mantissa) ++ndigits;
+        exponent--;
+      } else {
+        truncated |= d != 0;
+      }
     }
-    result1 += chartoint(**c) * n1;
-    n1 *= 0.1;
   }
-  *part1 = result1/n1*0.1;
-  return result;
+  const char* mantissa_end = c;
+  int e = 0;
+  if (c < end && (*c == 'e' || *c == 'E')) {
+    ++c;
+    // larger exponents are stored as MAX_EXPONENT + 1
+    bool negative_exponent = false;
+    uint64_t value = 0;
+    if (!parse_integer(c, end - c, MAX_EXPONENT, negative_exponent, value))
+      return false;
+    e = negative_exponent ? -static_cast<int>(value) : static_cast<int>(value);
+    c = end;
+  }
+  // the remainder can only contain blanks
+  for (; c < end; ++c) 
+    if (*c != ' ') return false;
+  exponent += e;
+  if (mantissa == 0) {
+    result = 0.0;
+  } else if (EXACT_DOUBLE_ARITHMETIC && !truncated && 
+      mantissa <= MAX_EXACT_INTEGER && 
+      exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER) {
+    // the mantissa and the power of ten are both exactly representable; one
+    // multiplication or division gives the correctly rounded result 
+    // (Clinger's fast path)
+    result = static_cast<double>(mantissa);
+    if (exponent < 0) result /= POWERS_OF_TEN[-exponent];
+    else result *= POWERS_OF_TEN[exponent];
+  } else {
+    // when digits were dropped the value lies between mantissa and 
+    // mantissa + 1; when both round to the same double that is the result
+    double upper = 0.0;
+    if (!eisel_lemire(mantissa, exponent, result) || (truncated && 
+        (!eisel_lemire(mantissa + 1, exponent, upper) || upper != result)))
+      result = strtod_fallback(begin, mantissa_end, dec, e);
+  }
+  if (negative) result = -result;
+  return true;
 }
 
-inline int read_after_decimal(double* part2, const char** c, unsigned int* i, unsigned int nchar, char dec) {
-  double n2 = 0.1;
-  *part2 = 0.0;
-  int result = 0;
-  for (; *i < nchar; ++*i, ++*c) {
-    if (**c == ' ') {
-      check_remainder(c, i, nchar);
-      break;
-    }
-    if (**c == 'E' || **c == 'e') {
-      ++*c; ++*i;
-      result = 2;
-      break;
-    }
-    *part2 += chartoint(**c) * n2;
-    n2 *= 0.1;
-  }
+double strtodouble(const char* str, unsigned int nchar, char dec) {
+  double result = 0.0;
+  if (!parse_double(str, nchar, result, dec)) throw ConversionError();
   return result;
 }
 
-inline double read_exponent(const char** c, unsigned int* i, unsigned int nchar) {
-  int e = strtoint(*c, nchar-*i);
-  *i = nchar;
-  return std::pow(10.0, e);
+// ============================================================================
+// ===                        BLOCKS OF FIELDS                             ====
+// ============================================================================
+
+// The converters and parse functions are defined in this file, which allows
+// the compiler to inline them into the loops below.
+
+bool IntConverter::operator()(const char* str, unsigned int nchar, 
+    int& result) const {
+  if (parse_int(str, nchar, result)) return true;
+  if (!all_chars_equal(str, nchar, ' ')) return false;
+  result = na_;
+  return true;
 }
 
-double strtodouble(const char* str, unsigned int nchar, char dec) {
-  if (nchar < 1) throw ConversionError();
-  // initialisation
-  const char*  c        = str;
-  unsigned int i        = 0;
-  double before_decimal = 0.0;
-  double after_decimal  = 0.0;
-  double exponent       = 1.0;
-  // start reading
-  double sign = read_sign(&c, &i, nchar); 
-  int    next = read_before_decimal(&before_decimal, &c, &i, nchar, dec); 
-  switch (next) {
-    case 1:
-      next = read_after_decimal(&after_decimal, &c, &i, nchar, dec); 
-      if (next != 2) break;
-    case 2:
-      exponent = read_exponent(&c, &i, nchar); 
-  }
-  // calculate end result
-  return sign * exponent*(before_decimal + after_decimal);
+bool DoubleConverter::operator()(const char* str, unsigned int nchar, 
+    double& result) const {
+  if (parse_double(str, nchar, result, dec_)) return true;
+  if (!all_chars_equal(str, nchar, ' ')) return false;
+  result = na_;
+  return true;
+}
+
+template<typename Converter, typename Fields>
+unsigned int convert_fields(const Converter& converter, const Fields& fields,
+    unsigned int first, unsigned int n, typename Converter::value_type* result) {
+  for (unsigned int j = first; j < n; ++j) 
+    if (!converter(fields.buffer(j), fields.length(j), result[j])) return j;
+  return n;
 }
 
+template unsigned int convert_fields(const IntConverter&, const SpanFields&,
+  unsigned int, unsigned int, int*);
+template unsigned int convert_fields(const IntConverter&, const StripeFields&,
+  unsigned int, unsigned int, int*);
+template unsigned int convert_fields(const DoubleConverter&, const SpanFields&,
+  unsigned int, unsigned int, double*);
+template unsigned int convert_fields(const DoubleConverter&, const StripeFields&,
+  unsigned int, unsigned int, double*);
+
 // ============================================================================
 // ===                 CONVERSION FROM CHAR* TO STRING                     ====
 // ============================================================================
 
-std::string chartostring(const char* c, unsigned int length, bool trim) {
-  if (trim) {
-    unsigned int newlength = length;
-    for (unsigned int i = 0; i < length; ++i) {
-      if (*c != ' ') break;
-      c++;
-      newlength--;
-    }
-    length = newlength;
-    const char* cend = c + length - 1;
-    for (unsigned int i = 0; i < newlength; ++i) {
-      if (*cend != ' ') break;
-      cend--;
-      length--;
-    }
+void trim_blanks(const char*& str, unsigned int& length) {
+  while (length > 0 && *str == ' ') {
+    ++str;
+    --length;
   }
+  while (length > 0 && str[length-1] == ' ') --length;
+}
+
+std::string chartostring(const char* c, unsigned int length, bool trim) {
+  if (trim) trim_blanks(c, length);
   return std::string(c, length);
 }
 
@@ -18,16 +18,96 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef CONVERSION_H
 #define CONVERSION_H
 
+#include <cstddef>
 #include <exception>
 #include <string>
 
 class ConversionError : public std::exception {};
 
+// Convert a field consisting of optional blanks, an optional sign directly 
+// followed by digits and optional blanks to int. Returns false when the 
+// field is not an integer or when the value does not fit in an int (INT_MIN
+// is not accepted; it is R's missing value).
+bool parse_int(const char* str, unsigned int nchar, int& result);
+// Convert a field to the correctly rounded double; the exponent is parsed 
+// as by parse_int. Returns false when the field is not a number.
+bool parse_double(const char* str, unsigned int nchar, double& result, 
+  char dec = '.');
+
+// As parse_int and parse_double; throw a ConversionError on failure.
 int strtoint(const char* str, unsigned int nchar);
 double strtodouble(const char* str, unsigned int nchar, char dec = '.');
 
 bool all_chars_equal(const char* str, unsigned int n, char c = ' ');
 
+// ============================================================================
+// ===                        BLOCKS OF FIELDS                             ====
+// ============================================================================
+
+// Field of a line; consists of the length bytes starting at buffer.
+struct FieldSpan {
+  const char* buffer;
+  unsigned int length;
+};
+
+// The fields of one column of a block of lines, as stored by the readers. 
+// Field j consists of length(j) bytes starting at buffer(j).
+
+// Fields stored as a table of spans (CSVReader).
+class SpanFields {
+  public:
+    SpanFields(const FieldSpan* spans) : spans_(spans) {}
+    const char* buffer(unsigned int j) const { return spans_[j].buffer;}
+    unsigned int length(unsigned int j) const { return spans_[j].length;}
+  private:
+    const FieldSpan* spans_;
+};
+
+// Fields of width bytes stored consecutively in a stripe (FWFReader).
+class StripeFields {
+  public:
+    StripeFields(const char* stripe, unsigned int width) : 
+      stripe_(stripe), width_(width) {}
+    const char* buffer(unsigned int j) const { return stripe_ + static_cast<size_t>(j)*width_;}
+    unsigned int length(unsigned int) const { return width_;}
+  private:
+    const char* stripe_;
+    unsigned int width_;
+};
+
+// Convert a field to a value of the type of a column; fields consisting of 
+// blanks are missing values. Return false when the field can not be 
+// converted.
+class IntConverter {
+  public:
+    typedef int value_type;
+    IntConverter(int na) : na_(na) {}
+    bool operator()(const char* str, unsigned int nchar, int& result) const;
+  private:
+    int na_;
+};
+
+class DoubleConverter {
+  public:
+    typedef double value_type;
+    DoubleConverter(double na, char dec = '.') : na_(na), dec_(dec) {}
+    bool operator()(const char* str, unsigned int nchar, double& result) const;
+  private:
+    double na_;
+    char dec_;
+};
+
+// Convert the fields [first, n) and store field j in result[j]. Conversion 
+// stops at the first field that can not be converted; returns the index of
+// that field or n when all fields were converted. The loop is compiled for 
+// each combination of converter and fields; IntConverter and 
+// DoubleConverter are instantiated with SpanFields and StripeFields.
+template<typename Converter, typename Fields>
+unsigned int convert_fields(const Converter& converter, const Fields& fields,
+  unsigned int first, unsigned int n, typename Converter::value_type* result);
+
+// Remove the leading and trailing blanks of the field [str, str + length).
+void trim_blanks(const char*& str, unsigned int& length);
 std::string chartostring(const char* str, unsigned int length, bool trim = false);
 
     
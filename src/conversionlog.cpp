@@ -0,0 +1,65 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "conversionlog.h"
+#include <algorithm>
+
+namespace {
+  bool entry_less(const ConversionLog::Entry& a, const ConversionLog::Entry& b) {
+    return a.line < b.line || (a.line == b.line && a.column < b.column);
+  }
+}
+
+ConversionLog::ConversionLog(unsigned int max_entries) : 
+  max_entries_(max_entries), count_(0), last_line_(UINT64_MAX)
+{
+}
+
+void ConversionLog::add(uint64_t line, unsigned int column, 
+    const char* buffer, unsigned int length) {
+  count_.fetch_add(1, std::memory_order_relaxed);
+  if (max_entries_ == 0 || line > last_line_.load(std::memory_order_relaxed)) 
+    return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry entry = {line, column, std::string(buffer, length)};
+  if (entries_.size() < max_entries_) {
+    entries_.push_back(entry);
+  } else {
+    // replace the failure on the highest line; only happens when lines are
+    // not converted in order (e.g. when using multiple threads)
+    std::vector<Entry>::iterator last = 
+      std::max_element(entries_.begin(), entries_.end(), entry_less);
+    if (!entry_less(entry, *last)) return;
+    *last = entry;
+  }
+  if (entries_.size() == max_entries_) last_line_.store(
+    std::max_element(entries_.begin(), entries_.end(), entry_less)->line);
+}
+
+void ConversionLog::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  count_.store(0);
+  last_line_.store(UINT64_MAX);
+}
+
+std::vector<ConversionLog::Entry> ConversionLog::get_entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Entry> entries(entries_);
+  std::sort(entries.begin(), entries.end(), entry_less);
+  return entries;
+}
@@ -0,0 +1,59 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef conversionlog_h
+#define conversionlog_h
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Log of the fields that could not be converted when failed conversions are
+// ignored. All failures are counted; only the max_entries failures on the 
+// lowest lines are stored. Failures can be added from multiple threads; the
+// common case (a failure after the log is full) does not need a lock.
+class ConversionLog {
+  public:
+    struct Entry {
+      uint64_t line;
+      unsigned int column;
+      std::string value;
+    };
+
+    ConversionLog(unsigned int max_entries = 100);
+
+    void add(uint64_t line, unsigned int column, const char* buffer, 
+      unsigned int length);
+    void clear();
+
+    uint64_t count() const { return count_.load();}
+    // The stored failures sorted by line and column.
+    std::vector<Entry> get_entries() const;
+
+  private:
+    unsigned int max_entries_;
+    std::atomic<uint64_t> count_;
+    // failures after this line are not stored; the highest line stored once 
+    // the log is full
+    std::atomic<uint64_t> last_line_;
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+#endif
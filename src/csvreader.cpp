@@ -19,139 +19,346 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #include "conversion.h"
 #include "column.h"
 #include "file.h"
+#include "filter.h"
+#include "gzipsource.h"
+#include <algorithm>
 #include <cstring>
+#include <deque>
 #include <stdexcept>
+#include <thread>
 
-CSVReader::CSVReader(const std::string& filename, int sep, unsigned int skip, unsigned int buffer_size) : Reader(),
-  filename_(filename), sep_(sep), skip_(skip), buffer_size_(buffer_size), buffer_filled_(1), 
-  pointer_(0), current_line_(0)
+namespace {
+  // Blocks smaller than this number of lines per thread are read using one
+  // thread
+  const unsigned int MIN_LINES_PER_THREAD = 1000;
+  // Maximum number of lines tokenized at once by read_block; larger blocks
+  // are read in parts
+  const unsigned int MAX_BLOCK_SIZE = 100000;
+}
+
+// Lines of a block that are tokenized and converted in chunks. Line i 
+// consists of [begins[i], ends[i]). When the blocks of the source remain valid
+// (e.g. for a memory mapped file) the lines point into these; otherwise the 
+// part of a block of the source used by the lines is copied before the 
+// source returns the next block. Lines that span two blocks of the source are
+// always copied. The buffers are reused by the following blocks.
+struct CSVBlock {
+  // The part of the block handled by one thread: lines [first, last). The 
+  // (selected) lines are assigned to the elements starting at offset.
+  struct Chunk {
+    unsigned int first;
+    unsigned int last;
+    unsigned int offset;
+    // first line that has not been parsed; either last, the line with the end
+    // of the data or the line on which an error occurred
+    unsigned int end;
+    bool failed;
+    std::string error;
+    std::vector<unsigned int> incomplete;
+    // the fields of the lines; one row of last - first fields per used column
+    std::vector<FieldSpan> spans;
+    // copies of the fields that are not a contiguous part of their line (e.g.
+    // quoted fields). As these are never longer than the lines they are taken
+    // from, the buffer does not need to grow while tokenizing. 
+    std::vector<char> scratch;
+    // with a filter, selected[j] is nonzero when line first + j passes
+    std::vector<unsigned char> selected;
+
+    const FieldSpan* get_spans(unsigned int field) const {
+      return &spans[static_cast<size_t>(field)*(last - first)];
+    }
+  };
+
+  int sep;
+  unsigned int ncolumns;
+  uint64_t first_line;
+  std::vector<const char*> begins;
+  std::vector<const char*> ends;
+  std::vector<char> terminated;
+  // copies of the lines; the first ncopies are used by the block
+  std::deque< std::vector<char> > copies;
+  unsigned int ncopies;
+  // when keep is set the lines [saved, end) point into the current block of 
+  // the source; see CSVReader::keep_block_lines
+  bool keep;
+  unsigned int saved;
+  // positions in the file of the lines; the last is the position after the
+  // block
+  std::vector<uint64_t> positions;
+  // columns that are assigned; thread safe columns are assigned by the
+  // thread that parses the chunk, the other columns afterwards in order
+  std::vector<Column*> columns;
+  // numbers of the columns that are tokenized; other fields are skipped
+  std::vector<unsigned int> used_columns;
+  // index in used_columns of the field of each of the columns
+  std::vector<unsigned int> fields;
+  // filter and the index in used_columns of the field of each condition
+  const Filter* filter;
+  std::vector<unsigned int> filter_fields;
+  std::vector<Chunk> chunks;
+
+  CSVBlock() : ncopies(0), keep(false), saved(0) {}
+
+  // Copy [begin, end) into the block; returns the start of the copy.
+  const char* copy(const char* begin, const char* end) {
+    if (ncopies == copies.size()) copies.push_back(std::vector<char>());
+    std::vector<char>& buffer = copies[ncopies++];
+    buffer.assign(begin, end);
+    return buffer.data();
+  }
+};
+
+namespace {
+  // Assign the fields of lines [first, end) of the chunk to the columns for
+  // which thread_safe() equals thread_safe. When a conversion fails, end is
+  // set to the line on which the failure occurred.
+  void assign_chunk(const CSVBlock* block, CSVBlock::Chunk* chunk, bool thread_safe, 
+      unsigned int end) {
+    if (end <= chunk->first) return;
+    unsigned int n = end - chunk->first;
+    uint64_t line = block->first_line + chunk->first + 1;
+    const unsigned char* selected = block->filter ? &chunk->selected[0] : 0;
+    try {
+      // runs of selected lines are converted one column at a time
+      unsigned int i = chunk->offset;
+      unsigned int first = 0;
+      while (first < n) {
+        if (selected && !selected[first]) {
+          ++first;
+          continue;
+        }
+        unsigned int last = selected ? first + 1 : n;
+        while (last < n && selected[last]) ++last;
+        for (unsigned int k = 0; k < block->columns.size(); ++k) {
+          Column* column = block->columns[k];
+          if (column->thread_safe() != thread_safe) continue;
+          column->assign_spans(i, chunk->get_spans(block->fields[k]) + first, 
+            last - first, line + first);
+        }
+        i += last - first;
+        first = last;
+      }
+    } catch(const std::exception&) {
+      // the lines are converted one column at a time; convert them again one
+      // line at a time to find the line on which the conversion failed
+      unsigned int i = chunk->offset;
+      for (unsigned int j = 0; j < n; ++j) {
+        if (selected && !selected[j]) continue;
+        try {
+          for (unsigned int k = 0; k < block->columns.size(); ++k) {
+            Column* column = block->columns[k];
+            if (column->thread_safe() != thread_safe) continue;
+            const FieldSpan& span = chunk->get_spans(block->fields[k])[j];
+            column->assign_at(i, span.buffer, span.length, line + j);
+          }
+        } catch(const std::exception& e) {
+          chunk->end = chunk->first + j;
+          chunk->failed = true;
+          chunk->error = e.what();
+          return;
+        }
+        ++i;
+      }
+    }
+  }
+
+  // Evaluate the filter of the block on the lines [first, end) of the chunk.
+  // When a field of a condition can not be converted, end is set to its line.
+  void select_chunk(const CSVBlock* block, CSVBlock::Chunk* chunk) {
+    unsigned int n = chunk->end - chunk->first;
+    // one extra element so that the selection is never empty
+    chunk->selected.assign(n + 1, 1);
+    std::vector<SpanFields> fields;
+    for (std::vector<unsigned int>::const_iterator p = block->filter_fields.begin();
+        p != block->filter_fields.end(); ++p) 
+      fields.push_back(SpanFields(chunk->get_spans(*p)));
+    std::string error;
+    unsigned int m = block->filter->select(fields, n, 
+      block->first_line + chunk->first + 1, &chunk->selected[0], error);
+    if (m < n) {
+      chunk->end = chunk->first + m;
+      chunk->failed = true;
+      chunk->error = error;
+    }
+  }
+
+  // Tokenize the lines of the chunk into the fields of the chunk, after 
+  // which the fields of the thread safe columns are assigned. With a filter,
+  // the lines are selected instead; these are assigned in a second pass once
+  // the number of lines selected by the preceding chunks is known.
+  void parse_chunk(const CSVBlock* block, CSVBlock::Chunk* chunk) {
+    unsigned int nlines = chunk->last - chunk->first;
+    unsigned int nfields = block->used_columns.size();
+    // the buffers only grow; as the span table is indexed using the number of
+    // lines of the chunk, it does not need to be cleared
+    size_t nspans = static_cast<size_t>(nfields)*nlines;
+    if (chunk->spans.size() < nspans) chunk->spans.resize(nspans);
+    size_t nchars = 0;
+    for (unsigned int i = chunk->first; i < chunk->last; ++i) 
+      nchars += block->ends[i] - block->begins[i];
+    if (chunk->scratch.size() < nchars) chunk->scratch.resize(nchars);
+    char* scratch = chunk->scratch.empty() ? 0 : &chunk->scratch[0];
+    unsigned int line = chunk->first;
+    try {
+      CSVTokenizer tokenizer(block->sep, block->ncolumns);
+      tokenizer.set_columns(block->used_columns);
+      for (; line < chunk->last; ++line) {
+        const char* begin = block->begins[line];
+        const char* end = block->ends[line];
+        CSVTokenizer::Result result = tokenizer.tokenize(begin, end, 
+          block->terminated[line] != 0);
+        if (result == CSVTokenizer::LINE_END) break;
+        if (result == CSVTokenizer::LINE_INCOMPLETE) 
+          chunk->incomplete.push_back(line);
+        FieldSpan* span = &chunk->spans[line - chunk->first];
+        for (unsigned int k = 0; k < nfields; ++k, span += nlines) {
+          unsigned int i = block->used_columns[k];
+          span->buffer = tokenizer.get_buffer(i);
+          span->length = tokenizer.get_length(i);
+          // fields in the scratch buffer of the tokenizer are overwritten 
+          // when the next line is tokenized
+          if (span->length > 0 && (span->buffer < begin || span->buffer > end)) {
+            std::memcpy(scratch, span->buffer, span->length);
+            span->buffer = scratch;
+            scratch += span->length;
+          }
+        }
+      }
+    } catch(const std::exception& e) {
+      chunk->failed = true;
+      chunk->error = e.what();
+    }
+    chunk->end = line;
+    if (block->filter) select_chunk(block, chunk);
+    else assign_chunk(block, chunk, true, chunk->end);
+  }
+}
+
+CSVReader::CSVReader(const std::string& filename, int sep, unsigned int skip, 
+    unsigned int buffer_size, bool use_mmap, unsigned int read_ahead) : Reader(),
+  filename_(filename), sep_(sep), source_(0), skip_(skip), buffer_(0), 
+  buffer_size_(buffer_size), buffer_filled_(0), pointer_(0), block_end_(0),
+  index_saved_(0), tokenizer_(0), current_line_(0), columns_changed_(false),
+  block_(0)
 {
-  offset_ = determine_offset(filename, skip_);
-  line_size_ = 1024;
-  line_ = new char[line_size_];
-  file_.open(get_filename().c_str(), std::ios::in|std::ios::binary);
-  if (file_.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  source_ = open_source(get_filename(), use_mmap, read_ahead);
+  offset_ = determine_offset(skip_);
+  ncolumns_ = determine_ncolumns();
   reset();
-  buffer_ = new char[buffer_size_];
-  ncolumns_ = determine_ncolumns(get_filename());
-  positions_ = new unsigned int[ncolumns_];
-  lengths_ = new unsigned int[ncolumns_];
-
+  tokenizer_ = new CSVTokenizer(sep_, ncolumns_);
+  block_ = new CSVBlock();
 }
 
 CSVReader::~CSVReader() {
-  if (file_.is_open()) file_.close();
-  if (buffer_) delete[] buffer_;
-  if (line_) delete[] line_;
-  if (positions_) delete[] positions_;
-  if (lengths_) delete[] lengths_;
-}
-
-unsigned int CSVReader::nlines() const {
-  std::ifstream input(filename_.c_str(), std::ios::in|std::ios::binary);
-  input.seekg(offset_, std::ios::beg);
-  char buffer[1000000];
-  char* bp;
-  unsigned int n = 0;
-  while (true) {
-    input.read(buffer, 1000000);
-    unsigned int nread = input.gcount();
-    if (nread == 0) break;
-    bp = buffer;
-    for (unsigned int i = 0; i < nread; ++i, ++bp) {
-      if (*bp == '\n') {
-	n++;
-      }
+  if (index_.size() > index_saved_) save_index();
+  if (source_) delete source_;
+  if (tokenizer_) delete tokenizer_;
+  if (block_) delete block_;
+}
+
+uint64_t CSVReader::nlines() const {
+  // the number of lines is cached in the index; it is recounted when the file
+  // has changed
+  if (!index_.complete() || !index_.matches(filename_)) {
+    GzipSource* gzip = dynamic_cast<GzipSource*>(source_);
+    if (gzip) {
+      // use a separate source in order not to disturb reading
+      GzipSource source(filename_, gzip->get_index());
+      index_.build(source, filename_, offset_);
+    } else {
+      index_.build(filename_, offset_, get_threads());
     }
-    if (input.eof()) break;
+    save_index();
   }
-  return n;
+  return index_.nlines();
 }
 
 void CSVReader::reset() {
-  file_.clear();
-  file_.seekg(offset_, std::ios::beg);
+  seek_line(0, offset_);
+}
+
+void CSVReader::seek_line(uint64_t line, uint64_t position) {
+  source_->seek(position);
+  block_end_ = position;
   buffer_filled_ = 0;
   pointer_ = 0;
-  current_line_ = 0; 
+  current_line_ = line;
 }
 
-#include <iostream>
-bool CSVReader::next_line() {
-  pointer_++;
-  unsigned int column_length = 0;
-  unsigned int column_position = 0;
-  unsigned int column = 0;
-  bool open_quote = false;
-  positions_[0] = 0;
+bool CSVReader::find_line(const char*& begin, const char*& end) {
+  // store the position of the start of the line in the index
+  index_.add(current_line_, block_end_ - buffer_filled_ + pointer_);
+  carry_.clear();
   while (true) {
     if (pointer_ >= buffer_filled_) {
+      keep_block_lines();
       pointer_ = 0;
-      file_.read(buffer_, buffer_size_);
-      buffer_filled_ = file_.gcount();
+      buffer_ = source_->next_block(buffer_size_, buffer_filled_);
+      block_end_ += buffer_filled_;
       if (buffer_filled_ == 0) {
-        if (column == ncolumns_) {
-          current_line_++;
-          return true;
-        } else return false;
+        begin = carry_.empty() ? 0 : &carry_[0];
+        end = begin + carry_.size();
+        return false;
       }
     }
-    for (; pointer_ < buffer_filled_; ++pointer_) {
-      if (open_quote) {
-        if (buffer_[pointer_] == '"') {
-          open_quote = false;
-        } else if (buffer_[pointer_] == '\n') {
-          throw(std::runtime_error("Line ended while open quote"));
-        } else if (buffer_[pointer_] == '\r') {
-          // ignore \r
-        } else {
-          column_length++;
-          if (column_position >= line_size_) resize_line_buffer();
-          line_[column_position++] = buffer_[pointer_];
-        }
+    const char* start = buffer_ + pointer_;
+    const char* eol = static_cast<const char*>(
+      std::memchr(start, '\n', buffer_filled_ - pointer_));
+    if (eol) {
+      pointer_ = (eol - buffer_) + 1;
+      if (carry_.empty()) {
+        begin = start;
+        end = eol;
       } else {
-        if (buffer_[pointer_] == '"' && column_length == 0) {
-          open_quote = true;
-        } else if (buffer_[pointer_] == sep_ || buffer_[pointer_] == '\n') {
-          lengths_[column] = column_length;
-          column++;
-          if (buffer_[pointer_] == '\n') {
-            current_line_++;
-            if (column > 1 && column < ncolumns_) {
-              Rcpp::warning("Warning: incomplete line found at line %i.", current_line_ );
-              for (unsigned int i = column; i != ncolumns_; ++i) {
-                lengths_[i] = 0;
-                positions_[i] = column_position;
-              }
-              return true;
-            }
-            //return true;
-            // we don't return true in order to handle the case of a single empty
-            // line; this is considered the end of the file; should there be an 
-            // empty line in the middle reading stops
-            return column==ncolumns_;
-          }
-          if (column >= ncolumns_) throw std::runtime_error("Line has too many columns");
-          positions_[column] = column_position;
-          column_length = 0;
-        } else if (buffer_[pointer_] == '\r') {
-          // ignore \r
-        } else {
-          column_length++;
-          if (column_position >= line_size_) resize_line_buffer();
-          line_[column_position++] = buffer_[pointer_];
-        }
+        carry_.insert(carry_.end(), start, eol);
+        begin = &carry_[0];
+        end = begin + carry_.size();
       }
+      return true;
     }
+    // line continues in the next block
+    carry_.insert(carry_.end(), start, buffer_ + buffer_filled_);
+    pointer_ = buffer_filled_;
   }
-  current_line_++;
-  return true;
 }
 
-bool CSVReader::goto_line(unsigned int line) {
+void CSVReader::keep_block_lines() {
+  CSVBlock& block = *block_;
+  if (!block.keep || block.saved == block.begins.size()) return;
+  // the lines are consecutive in the block of the source; copy them at once
+  const char* first = block.begins[block.saved];
+  const char* copy = block.copy(first, block.ends.back());
+  for (unsigned int i = block.saved; i < block.begins.size(); ++i) {
+    block.begins[i] = copy + (block.begins[i] - first);
+    block.ends[i] = copy + (block.ends[i] - first);
+  }
+  block.saved = block.begins.size();
+}
+
+bool CSVReader::next_line() {
+  const char* begin;
+  const char* end;
+  bool terminated = find_line(begin, end);
+  CSVTokenizer::Result result = tokenizer_->tokenize(begin, end, terminated);
+  columns_changed_ = false;
+  if (terminated || result != CSVTokenizer::LINE_END) current_line_++;
+  if (result == CSVTokenizer::LINE_INCOMPLETE) 
+    Rcpp::warning("Warning: incomplete line found at line %i.", current_line_ );
+  // an empty line is considered the end of the file; should there be an 
+  // empty line in the middle reading stops
+  return result != CSVTokenizer::LINE_END;
+}
+
+bool CSVReader::goto_line(uint64_t line) {
   line++;
-  if (current_line_ == line) return true;
-  if (current_line_ > line) reset();
+  if (current_line_ == line && !columns_changed_) return true;
+  // when going back, or when the index allows us to skip lines, continue 
+  // from the last indexed line before the requested line. The current line
+  // is read again when it was tokenized for other columns.
+  uint64_t position = offset_;
+  uint64_t indexed = index_.lookup(line-1, position);
+  if (current_line_ >= line || indexed > current_line_) 
+    seek_line(indexed, position);
   bool result = true;
   while ((current_line_ < line) && result) {
     result = next_line();
@@ -160,42 +367,219 @@ bool CSVReader::goto_line(unsigned int line) {
 }
 
 const char* CSVReader::get_buffer(unsigned int i) const {
-  return line_ + positions_[i];
+  return tokenizer_->get_buffer(i);
 }
 
 unsigned int CSVReader::get_length(unsigned int i) const {
-  return lengths_[i];
+  return tokenizer_->get_length(i);
+}
+
+void CSVReader::set_used_columns(const std::vector<unsigned int>& columns) {
+  if (tokenizer_->set_columns(columns)) columns_changed_ = true;
+}
+
+unsigned int CSVReader::read_block(const std::vector<Column*>& columns, 
+    unsigned int nlines, const Filter* filter) {
+  if (filter && filter->empty()) filter = 0;
+  unsigned int nread = 0;
+  while (nread < nlines) {
+    unsigned int n = std::min(nlines - nread, MAX_BLOCK_SIZE);
+    unsigned int nassigned = 0;
+    unsigned int m = convert_block(columns, n, nread, filter, nassigned);
+    nread += nassigned;
+    if (m < n) break;
+  }
+  return nread;
+}
+
+unsigned int CSVReader::convert_block(const std::vector<Column*>& columns, 
+    unsigned int nlines, unsigned int offset, const Filter* filter, 
+    unsigned int& nassigned) {
+  // the tokenizer of the reader no longer contains the current line
+  columns_changed_ = true;
+  // read the lines of the block; as quoted fields can not contain line breaks
+  // lines can be split without parsing them
+  CSVBlock& block = *block_;
+  block.sep = sep_;
+  block.ncolumns = ncolumns_;
+  block.first_line = current_line_;
+  block.begins.clear();
+  block.ends.clear();
+  block.terminated.clear();
+  block.positions.clear();
+  block.ncopies = 0;
+  block.keep = !source_->blocks_persist();
+  block.saved = 0;
+  try {
+    while (block.begins.size() < nlines) {
+      block.positions.push_back(block_end_ - buffer_filled_ + pointer_);
+      const char* begin;
+      const char* end;
+      bool terminated = find_line(begin, end);
+      // lines that span two blocks of the source are returned in carry_ 
+      // which is reused for the next line
+      if (!carry_.empty()) {
+        begin = block.copy(begin, end);
+        end = begin + carry_.size();
+        block.saved = block.begins.size() + 1;
+      }
+      block.begins.push_back(begin);
+      block.ends.push_back(end);
+      block.terminated.push_back(terminated);
+      current_line_++;
+      // the end of the file or an empty line ends the data
+      if (!terminated || begin == end) break;
+    }
+  } catch(...) {
+    block.keep = false;
+    throw;
+  }
+  block.keep = false;
+  block.positions.push_back(block_end_ - buffer_filled_ + pointer_);
+  unsigned int nread = block.begins.size();
+  // columns that read the same field share its fields
+  block.columns.clear();
+  block.used_columns.clear();
+  block.fields.clear();
+  for (std::vector<Column*>::const_iterator p = columns.begin(); p != columns.end(); ++p) {
+    unsigned int column = (*p)->get_column_number();
+    std::vector<unsigned int>::const_iterator field = std::find(
+      block.used_columns.begin(), block.used_columns.end(), column);
+    block.fields.push_back(field - block.used_columns.begin());
+    if (field == block.used_columns.end()) block.used_columns.push_back(column);
+    block.columns.push_back(*p);
+  }
+  block.filter = filter;
+  block.filter_fields.clear();
+  if (filter) {
+    std::vector<unsigned int> filter_columns = filter->get_columns();
+    for (std::vector<unsigned int>::const_iterator p = filter_columns.begin(); 
+        p != filter_columns.end(); ++p) {
+      std::vector<unsigned int>::const_iterator field = std::find(
+        block.used_columns.begin(), block.used_columns.end(), *p);
+      block.filter_fields.push_back(field - block.used_columns.begin());
+      if (field == block.used_columns.end()) block.used_columns.push_back(*p);
+    }
+  }
+  // parse the lines
+  unsigned int nthreads = std::min(get_threads(), nread / MIN_LINES_PER_THREAD);
+  if (nthreads < 1) nthreads = 1;
+  unsigned int chunk_size = (nread + nthreads - 1) / nthreads;
+  std::vector<CSVBlock::Chunk>& chunks = block.chunks;
+  if (chunks.size() < nthreads) chunks.resize(nthreads);
+  for (unsigned int i = 0; i < nthreads; ++i) {
+    chunks[i].first = std::min(i * chunk_size, nread);
+    chunks[i].last = std::min((i + 1) * chunk_size, nread);
+    chunks[i].offset = offset + chunks[i].first;
+    chunks[i].end = chunks[i].first;
+    chunks[i].failed = false;
+    chunks[i].error.clear();
+    chunks[i].incomplete.clear();
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (unsigned int i = 1; i < nthreads; ++i) {
+    try {
+      threads.push_back(std::thread(parse_chunk, &block, &chunks[i]));
+    } catch(const std::exception&) {
+      parse_chunk(&block, &chunks[i]);
+    }
+  }
+  parse_chunk(&block, &chunks[0]);
+  for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+    p->join();
+  // with a filter the thread safe columns are assigned in a second parallel
+  // pass; the selected lines of a chunk follow those of the preceding chunks
+  if (filter) {
+    unsigned int element = offset;
+    for (unsigned int i = 0; i < nthreads; ++i) {
+      CSVBlock::Chunk& chunk = chunks[i];
+      chunk.offset = element;
+      element += std::count(chunk.selected.begin(), 
+        chunk.selected.begin() + (chunk.end - chunk.first), 1);
+    }
+    threads.clear();
+    for (unsigned int i = 1; i < nthreads; ++i) {
+      try {
+        threads.push_back(std::thread(assign_chunk, &block, &chunks[i], true, 
+          chunks[i].end));
+      } catch(const std::exception&) {
+        assign_chunk(&block, &chunks[i], true, chunks[i].end);
+      }
+    }
+    assign_chunk(&block, &chunks[0], true, chunks[0].end);
+    for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+      p->join();
+  }
+  // determine where the data ends
+  std::string error;
+  for (unsigned int i = 0; i < nthreads; ++i) {
+    const CSVBlock::Chunk& chunk = chunks[i];
+    for (std::vector<unsigned int>::const_iterator p = chunk.incomplete.begin();
+        p != chunk.incomplete.end(); ++p) {
+      Rcpp::warning("Warning: incomplete line found at line %i.", 
+        block.first_line + (*p) + 1);
+    }
+    if (chunk.end < chunk.last) {
+      nread = chunk.end;
+      if (chunk.failed) error = chunk.error;
+      break;
+    }
+  }
+  // continue reading after the last line used; an empty line at the end of 
+  // the file is read again
+  unsigned int next = nread;
+  if (nread < block.begins.size() && (!error.empty() || block.terminated[nread]))
+    next++;
+  if (next < block.begins.size()) 
+    seek_line(block.first_line + next, block.positions[next]);
+  if (!error.empty()) throw std::runtime_error(error);
+  // assign the remaining columns in order
+  for (unsigned int i = 0; i < nthreads && chunks[i].first < nread; ++i) {
+    assign_chunk(&block, &chunks[i], false, std::min(chunks[i].end, nread));
+    if (chunks[i].failed) throw std::runtime_error(chunks[i].error);
+  }
+  nassigned = filter ? 0 : nread;
+  for (unsigned int i = 0; filter && i < nthreads && chunks[i].first < nread; ++i) 
+    nassigned += std::count(chunks[i].selected.begin(), chunks[i].selected.begin() + 
+      (std::min(chunks[i].end, nread) - chunks[i].first), 1);
+  return nread;
 }
 
 const std::string& CSVReader::get_filename() const {
   return filename_;
 }
 
+void CSVReader::set_index_filename(const std::string& index_filename) {
+  index_filename_ = index_filename;
+  if (index_.read(index_filename_, filename_, offset_)) 
+    index_saved_ = index_.size();
+}
+
+void CSVReader::save_index() const {
+  if (index_filename_.empty()) return;
+  if (index_.write(index_filename_, filename_, offset_)) 
+    index_saved_ = index_.size();
+}
+
 // ============================================================================
 // ============================================================================
 // ============================================================================
 
-unsigned int CSVReader::determine_offset(const std::string& filename, unsigned int skip) {
-  std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
-  unsigned int offset = 0;
-  if (has_bom(filename)) {
-    offset = 3;
-    input.seekg(3, std::ios::end);
-  }
+uint64_t CSVReader::determine_offset(unsigned int skip) {
+  uint64_t offset = has_bom(source_) ? 3 : 0;
+  SourceStream input(source_, offset);
   while (skip > 0) {
     int c = input.get();
+    if (c == EOF) break;
     offset++;
     if (c == '\n') skip--;
-    if (input.eof()) break;
   }
-  input.close();
   return offset;
 }
 
-unsigned int CSVReader::determine_ncolumns(const std::string& filename) {
-  std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
-  input.clear();
-  input.seekg(offset_, std::ios::beg);
+unsigned int CSVReader::determine_ncolumns() {
+  SourceStream input(source_, offset_);
   int ncolumns = 0;
   bool empty = true;
   bool open_quote = false;
@@ -218,20 +602,8 @@ unsigned int CSVReader::determine_ncolumns(const std::string& filename) {
     } else {
       empty = false;
     }
-    if (input.eof()) break;
+    if (c == EOF) break;
   }
-  input.close();
   return ncolumns;
 }
 
-void CSVReader::resize_line_buffer() {
-  unsigned int new_size = line_size_*2;
-  if (new_size < 1024) new_size = 1024;
-  char* new_line = new char[new_size];
-  std::strncpy(new_line, line_, line_size_);
-  line_size_ = 0;
-  delete[] line_;
-  line_size_ = new_size;
-  line_ = new_line;
-}
-
@@ -19,53 +19,104 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #define csvreader_h
 
 #include "reader.h"
-#include <fstream>
+#include "source.h"
+#include "csvtokenizer.h"
+#include "lineindex.h"
 #include <string>
+#include <vector>
+
+struct CSVBlock;
 
 class CSVReader : public Reader {
   public:
     CSVReader(const std::string& filename, int sep = ',', unsigned int skip = 0, 
-      unsigned int buffer_size = 1E5);
+      unsigned int buffer_size = 1E5, bool use_mmap = false, 
+      unsigned int read_ahead = 0);
     virtual ~CSVReader();
 
-    unsigned int nlines() const;
+    uint64_t nlines() const;
 
     void reset();
     bool next_line();
-    bool goto_line(unsigned int line);
+    bool goto_line(uint64_t line);
 
-    unsigned int get_current_line() const { return current_line_+1;};
+    uint64_t get_current_line() const { return current_line_+1;};
 
     const char* get_buffer(unsigned int i) const;
     unsigned int get_length(unsigned int i) const;
 
+    // Fields after the last used column are not tokenized.
+    void set_used_columns(const std::vector<unsigned int>& columns);
+
+    // The lines of the block are first tokenized into a table with the 
+    // fields of each column, after which each column converts its fields in
+    // one call. When more than one thread is used, the lines are split into
+    // chunks which are parsed in parallel. With a filter, the conditions are
+    // evaluated on the table after which only the lines that pass are 
+    // converted.
+    unsigned int read_block(const std::vector<Column*>& columns,
+      unsigned int nlines, const Filter* filter = 0);
+
     const std::string& get_filename() const;
 
+    // When set the line index is read from, and stored in, index_filename. 
+    void set_index_filename(const std::string& index_filename);
+
   protected:
-    unsigned int determine_ncolumns(const std::string& filename);
-    unsigned int determine_offset(const std::string& filename, unsigned int skip);
+    unsigned int determine_ncolumns();
+    uint64_t determine_offset(unsigned int skip);
+
+    // Position the reader at the start of line; position is the byte
+    // position of that line.
+    void seek_line(uint64_t line, uint64_t position);
+    void save_index() const;
+
+    // Locate the next line in the file; on return [begin, end) contains the
+    // line without the line break. Returns false when the line is not
+    // terminated by a line break; e.g. at the end of the file.
+    bool find_line(const char*& begin, const char*& end);
+    // While convert_block reads the lines of a block from a source of which
+    // the blocks do not remain valid, copy the lines that point into the 
+    // current block of the source; called before the next block is read.
+    void keep_block_lines();
+
+    // Read at most nlines lines and assign them to the columns starting at
+    // element offset; with a filter only the lines that pass. Returns the 
+    // number of lines read; nassigned is set to the number of lines assigned.
+    unsigned int convert_block(const std::vector<Column*>& columns, 
+      unsigned int nlines, unsigned int offset, const Filter* filter, 
+      unsigned int& nassigned);
 
   private:
     // file
     std::string filename_;
     int sep_;
-    std::fstream file_;
+    Source* source_;
     unsigned int ncolumns_;
-    unsigned int offset_;
+    uint64_t offset_;
     unsigned int skip_;
     // buffer
-    char* buffer_;
+    const char* buffer_;
     unsigned int buffer_size_;
     unsigned int buffer_filled_;
     unsigned int pointer_;
-
-    // line buffer
-    void resize_line_buffer();
-    unsigned int line_size_;
-    char* line_;
-    unsigned int* positions_;
-    unsigned int* lengths_;
-    unsigned int current_line_;
+    uint64_t block_end_;
+    // line that does not fit in the current buffer
+    std::vector<char> carry_;
+
+    // index
+    mutable LineIndex index_;
+    std::string index_filename_;
+    mutable unsigned int index_saved_;
+
+    // current line
+    CSVTokenizer* tokenizer_;
+    uint64_t current_line_;
+    // the used columns changed after the current line was tokenized, or the
+    // current line was read by read_block without the tokenizer
+    bool columns_changed_;
+    // used by read_block; kept to reuse the allocated memory
+    CSVBlock* block_;
 };
 
 #endif
@@ -0,0 +1,122 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "csvtokenizer.h"
+#include <cstring>
+#include <stdexcept>
+
+CSVTokenizer::CSVTokenizer(int sep, unsigned int ncolumns) : sep_(sep),
+  ncolumns_(ncolumns), used_(ncolumns > 0 ? ncolumns : 1, 1), 
+  last_used_(ncolumns > 0 ? ncolumns - 1 : 0), scan_(get_scanner()), 
+  line_(1024), scratch_(0), in_scratch_(false), 
+  buffers_(ncolumns > 0 ? ncolumns : 1), lengths_(ncolumns > 0 ? ncolumns : 1)
+{
+}
+
+bool CSVTokenizer::set_columns(const std::vector<unsigned int>& columns) {
+  std::vector<char> used(used_.size(), columns.empty() ? 1 : 0);
+  unsigned int last_used = columns.empty() ? used_.size() - 1 : 0;
+  for (std::vector<unsigned int>::const_iterator p = columns.begin(); 
+      p != columns.end(); ++p) {
+    if (*p >= used.size()) continue;
+    used[*p] = 1;
+    if (*p > last_used) last_used = *p;
+  }
+  if (used == used_) return false;
+  used_.swap(used);
+  last_used_ = last_used;
+  return true;
+}
+
+CSVTokenizer::Result CSVTokenizer::tokenize(const char* begin, const char* end,
+    bool terminated) {
+  // fields are never longer than the line; therefore, the scratch buffer does
+  // not need to grow while tokenizing
+  if (static_cast<size_t>(end - begin) > line_.size()) line_.resize(end - begin);
+  scratch_ = &line_[0];
+  in_scratch_ = false;
+  unsigned int column = 0;
+  bool open_quote = false;
+  start_field(column, begin);
+  for (const char* p = begin; p < end; ++p) {
+    if (open_quote) {
+      if (*p == '"') {
+        open_quote = false;
+      } else if (*p == '\r') {
+        // ignore \r
+      } else {
+        // add all characters up to the next character that needs handling
+        const char* run_end = scan_(p + 1, end, '"', '"', '\r', '\r');
+        add_to_field(column, p, run_end - p);
+        p = run_end - 1;
+      }
+    } else {
+      if (*p == '"' && lengths_[column] == 0) {
+        open_quote = true;
+      } else if (*p == sep_) {
+        // the remaining fields are not needed; as quoted fields can not 
+        // contain line breaks we can stop here
+        if (column == last_used_ && column + 1 < ncolumns_) 
+          return terminated ? LINE_OK : LINE_END;
+        column++;
+        if (column >= ncolumns_) throw std::runtime_error("Line has too many columns");
+        start_field(column, p + 1);
+      } else if (*p == '\r') {
+        // ignore \r
+      } else {
+        // add all characters up to the next character that needs handling
+        const char* run_end = scan_(p + 1, end, sep_, '"', '\r', '\r');
+        add_to_field(column, p, run_end - p);
+        p = run_end - 1;
+      }
+    }
+  }
+  // a line that is not terminated by a line break only contains data when all
+  // columns have been found
+  if (!terminated) return column == ncolumns_ ? LINE_OK : LINE_END;
+  if (open_quote) throw std::runtime_error("Line ended while open quote");
+  column++;
+  if (column > 1 && column < ncolumns_) {
+    for (unsigned int i = column; i != ncolumns_; ++i) start_field(i, end);
+    return LINE_INCOMPLETE;
+  }
+  // a single empty line is considered the end of the file; should there be
+  // an empty line in the middle reading stops
+  return column == ncolumns_ ? LINE_OK : LINE_END;
+}
+
+void CSVTokenizer::add_to_field(unsigned int column, const char* str, 
+    unsigned int n) {
+  const char*& buffer = buffers_[column];
+  unsigned int& length = lengths_[column];
+  if (!used_[column]) {
+    // only the length is needed to recognise quotes
+  } else if (length == 0 && !in_scratch_) {
+    buffer = str;
+  } else if (in_scratch_ || buffer + length != str) {
+    // the field is not a contiguous part of the line (e.g. because of quotes
+    // or \r); copy the field to the scratch buffer
+    if (!in_scratch_) {
+      std::memmove(scratch_, buffer, length);
+      buffer = scratch_;
+      in_scratch_ = true;
+    }
+    std::memcpy(scratch_ + length, str, n);
+  }
+  length += n;
+}
+
@@ -0,0 +1,84 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef csvtokenizer_h
+#define csvtokenizer_h
+
+#include "scanner.h"
+#include <vector>
+
+// Splits a line of a CSV file into fields. The tokenizer does not depend on
+// the reader; each thread reading from a file can have its own tokenizer.
+class CSVTokenizer {
+  public:
+    enum Result {
+      // line does not contain data; e.g. an empty line. Is considered the end
+      // of the file.
+      LINE_END,
+      LINE_OK,
+      // line has less columns than it should have; the remaining columns are
+      // empty
+      LINE_INCOMPLETE
+    };
+
+    CSVTokenizer(int sep, unsigned int ncolumns);
+
+    // Only the fields of columns are needed; other fields are not stored and
+    // tokenizing stops after the last of columns. As a consequence lines with 
+    // too many columns are not detected. An empty vector selects all columns.
+    // Returns true when the selection changed.
+    bool set_columns(const std::vector<unsigned int>& columns);
+
+    // Split the line [begin, end) into fields. terminated should be true when
+    // the line was ended by a line break (and false when the line was ended
+    // by the end of the file). Throws when the line contains too many columns
+    // or when a quote is not closed.
+    Result tokenize(const char* begin, const char* end, bool terminated);
+
+    // Fields that are a contiguous part of the line point directly into
+    // [begin, end) of the last call to tokenize; only fields that need to be
+    // rewritten (e.g. quoted fields) are copied into a scratch buffer. The
+    // buffers remain valid as long as [begin, end) is valid and tokenize is 
+    // not called again.
+    const char* get_buffer(unsigned int i) const { return buffers_[i];}
+    unsigned int get_length(unsigned int i) const { return lengths_[i];}
+
+  private:
+    void start_field(unsigned int column, const char* position) {
+      buffers_[column] = position;
+      lengths_[column] = 0;
+      scratch_ += in_scratch_ ? lengths_[column - 1] : 0;
+      in_scratch_ = false;
+    }
+    void add_to_field(unsigned int column, const char* str, unsigned int n);
+
+    int sep_;
+    unsigned int ncolumns_;
+    // selected columns
+    std::vector<char> used_;
+    unsigned int last_used_;
+    ScanFunction scan_;
+    // scratch buffer
+    std::vector<char> line_;
+    char* scratch_;
+    bool in_scratch_;
+    // fields
+    std::vector<const char*> buffers_;
+    std::vector<unsigned int> lengths_;
+};
+
+#endif
@@ -18,8 +18,6 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #include "doublecolumn.h"
 #include "reader.h"
 #include "conversion.h"
-#include <stdexcept>
-#include <sstream>
 
 DoubleColumn::DoubleColumn(const Reader* reader, unsigned int column,
     bool ignore_failed_conversion) :
@@ -38,20 +36,41 @@ char DoubleColumn::get_decimal_seperator() const {
 }
 
 double DoubleColumn::get_value() const {
-  const char*  buffer = reader_->get_buffer(column_);
-  unsigned int length = reader_->get_length(column_);
-  try {
-    if (length == 0 || all_chars_equal(buffer, length, ' ')) return NA_REAL;
-    return strtodouble(buffer, length, decimal_seperator_);
-  } catch(const std::exception& e) {
-    if (ignore_failed_conversion_) return NA_REAL;
-    std::ostringstream message;
-    message << "Conversion to double failed; line=" << reader_->get_current_line()-1
-      << "; column=" << (column_ + 1L)
-      << "; string='" << std::string(buffer, length) << "'";
-    throw std::runtime_error(message.str());
+  return convert(reader_->get_buffer(column_), reader_->get_length(column_),
+    reader_->get_current_line()-1);
+}
+
+template<typename Fields>
+void DoubleColumn::assign_fields(unsigned int i, const Fields& fields, 
+    unsigned int n, uint64_t line) {
+  DoubleConverter converter(NA_REAL, decimal_seperator_);
+  double* p = pv + i;
+  // the conversion loop stops at fields that can not be converted
+  for (unsigned int j = convert_fields(converter, fields, 0, n, p); j < n;
+      j = convert_fields(converter, fields, j + 1, n, p)) {
+    conversion_failed(fields.buffer(j), fields.length(j), line + j, "double");
+    p[j] = NA_REAL;
   }
 }
 
+void DoubleColumn::assign_stripe(unsigned int i, const char* stripe, 
+    unsigned int width, unsigned int n, uint64_t line) {
+  assign_fields(i, StripeFields(stripe, width), n, line);
+}
+
+void DoubleColumn::assign_spans(unsigned int i, const FieldSpan* spans, 
+    unsigned int n, uint64_t line) {
+  assign_fields(i, SpanFields(spans), n, line);
+}
+
+double DoubleColumn::convert(const char* buffer, unsigned int length, 
+    uint64_t line) const {
+  DoubleConverter converter(NA_REAL, decimal_seperator_);
+  double value = NA_REAL;
+  if (converter(buffer, length, value)) return value;
+  conversion_failed(buffer, length, line, "double");
+  return NA_REAL;
+}
+
 
 
@@ -30,6 +30,7 @@ class DoubleColumn : public Column {
     char get_decimal_seperator() const;
 
     double get_value() const;
+    double convert(const char* buffer, unsigned int length, uint64_t line) const;
 
     double get_double() const {
       return get_value();
@@ -40,11 +41,33 @@ class DoubleColumn : public Column {
         return NA_INTEGER;
       return value;
     }
+    double get_double(const char* buffer, unsigned int length, 
+        uint64_t line) const {
+      return convert(buffer, length, line);
+    }
+    int get_int(const char* buffer, unsigned int length, 
+        uint64_t line) const {
+      double value = convert(buffer, length, line);
+      if (ISNAN(value) || value > INT_MAX || value < INT_MIN)
+        return NA_INTEGER;
+      return value;
+    }
 
     virtual void assign() {
       (*pv) = get_value();
     }
 
+    virtual void assign_at(unsigned int i, const char* buffer, 
+        unsigned int length, uint64_t line) {
+      pv[i] = convert(buffer, length, line);
+    }
+
+    virtual void assign_stripe(unsigned int i, const char* stripe, 
+      unsigned int width, unsigned int n, uint64_t line);
+    virtual void assign_spans(unsigned int i, const FieldSpan* spans, 
+      unsigned int n, uint64_t line);
+    virtual bool thread_safe() const { return true;}
+
     virtual void init(Rcpp::List::Proxy proxy) {
       v = proxy;
       pv = v.begin();
@@ -55,6 +78,11 @@ class DoubleColumn : public Column {
     }
     
   private:
+    // Assign n fields using the conversion loop for the layout of fields.
+    template<typename Fields>
+    void assign_fields(unsigned int i, const Fields& fields, unsigned int n,
+      uint64_t line);
+
     Rcpp::NumericVector v;
     double* pv;
     char decimal_seperator_;
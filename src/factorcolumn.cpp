@@ -20,7 +20,8 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #include "conversion.h"
 
 FactorColumn::FactorColumn(const Reader* reader, unsigned int column) :
-  Column(reader, column), trim_(false)
+  Column(reader, column), trim_(false), unknown_to_na_(false), 
+  levels_(new LevelDictionary())
 { }
 
 FactorColumn::~FactorColumn() {
@@ -33,22 +34,66 @@ void FactorColumn::set_trim(bool trim) {
 bool FactorColumn::get_trim() const {
   return trim_;
 }
+
+void FactorColumn::set_unknown_to_na(bool unknown_to_na) {
+  unknown_to_na_ = unknown_to_na;
+}
+
+bool FactorColumn::get_unknown_to_na() const {
+  return unknown_to_na_;
+}
     
 int FactorColumn::get_value() const {
-  const char*  buffer = reader_->get_buffer(column_);
-  unsigned int length = reader_->get_length(column_);
-  std::string value = chartostring(buffer, length, trim_);
-  if (value.length() == 0) return NA_INTEGER;
-  //if (length == 0 || all_chars_equal(buffer, length, ' ')) return NA_INTEGER;
-  //if (length == 0) return NA_INTEGER;
-  //std::string value(buffer, length);
-  if (levels_[value] == 0) {
-    levels_[value] = levels_.size();
+  return convert(reader_->get_buffer(column_), reader_->get_length(column_));
+}
+
+int FactorColumn::convert(const char* buffer, unsigned int length) const {
+  if (trim_) trim_blanks(buffer, length);
+  if (length == 0) return NA_INTEGER;
+  if (unknown_to_na_) {
+    int code = levels_->find(buffer, length);
+    return code ? code : NA_INTEGER;
   }
-  return levels_[value];
+  return levels_->add(buffer, length);
+}
+
+bool FactorColumn::is_na(const char* buffer, unsigned int length) const {
+  if (trim_) trim_blanks(buffer, length);
+  if (length == 0) return true;
+  return unknown_to_na_ && levels_->find(buffer, length) == 0;
+}
+
+void FactorColumn::assign_spans(unsigned int i, const FieldSpan* spans, 
+    unsigned int n, uint64_t) {
+  int* p = pv + i;
+  for (unsigned int j = 0; j < n; ++j, ++p) 
+    *p = convert(spans[j].buffer, spans[j].length);
+}
+
+void FactorColumn::finish() {
+  unsigned int nlabels = labels_.size();
+  unsigned int nlevels = levels_->size();
+  if (nlevels != nlabels) {
+    Rcpp::CharacterVector labels(nlevels);
+    for (unsigned int i = 0; i < nlabels; ++i) labels[i] = labels_[i];
+    for (unsigned int i = nlabels; i < nlevels; ++i) 
+      labels[i] = levels_->get_level(i + 1);
+    labels_ = labels;
+  }
+  v.attr("levels") = labels_;
+  v.attr("class") = "factor";
+}
+
+const LevelDictionary& FactorColumn::get_levels() const {
+  return *levels_;
+}
+
+void FactorColumn::set_levels(std::shared_ptr<LevelDictionary> levels) {
+  levels_ = levels;
+  labels_ = Rcpp::CharacterVector(0);
 }
 
-const std::map<std::string, int>& FactorColumn::get_levels() const {
+std::shared_ptr<LevelDictionary> FactorColumn::get_shared_levels() const {
   return levels_;
 }
 
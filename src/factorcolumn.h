@@ -19,8 +19,9 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #define factorcolumn_h
 
 #include "column.h"
+#include "leveldictionary.h"
+#include <memory>
 #include <string>
-#include <map>
 
 class FactorColumn : public Column {
   public:
@@ -35,18 +36,51 @@ class FactorColumn : public Column {
     int get_int() const {
       return get_value();
     }
+    double get_double(const char* buffer, unsigned int length, 
+        uint64_t) const {
+      int value = convert(buffer, length);
+      if (value == NA_INTEGER) return NA_REAL;
+      return value;
+    }
+    int get_int(const char* buffer, unsigned int length, 
+        uint64_t) const {
+      return convert(buffer, length);
+    }
 
     void set_trim(bool trim);
     bool get_trim() const;
 
-    int get_value() const;
+    // When true, values that are not one of the levels are missing; 
+    // otherwise these are added as new levels.
+    void set_unknown_to_na(bool unknown_to_na);
+    bool get_unknown_to_na() const;
 
-    const std::map<std::string, int>& get_levels() const;
+    int get_value() const;
+    int convert(const char* buffer, unsigned int length) const;
+    // Returns true when the value is missing. Unlike convert, does not add
+    // the value to the levels.
+    bool is_na(const char* buffer, unsigned int length) const;
+
+    // The levels are numbered in the order in which they are encountered.
+    const LevelDictionary& get_levels() const;
+    // Replaces the levels of the column; e.g. by levels that are known in 
+    // advance. The levels can be shared with columns of other readers, in 
+    // which case the codes of these columns are the same. Should be called 
+    // before reading.
+    void set_levels(std::shared_ptr<LevelDictionary> levels);
+    std::shared_ptr<LevelDictionary> get_shared_levels() const;
 
     virtual void assign() {
       (*pv) = get_value();
     }
 
+    virtual void assign_at(unsigned int i, const char* buffer, 
+        unsigned int length, uint64_t) {
+      pv[i] = convert(buffer, length);
+    }
+    virtual void assign_spans(unsigned int i, const FieldSpan* spans, 
+      unsigned int n, uint64_t line);
+
     virtual void init(Rcpp::List::Proxy proxy) {
       v = proxy;
       pv = v.begin();
@@ -55,10 +89,19 @@ class FactorColumn : public Column {
     virtual void next() {
       ++pv;
     }
+
+    // Makes the vector a factor. The codes are the positions of the levels
+    // in the dictionary; therefore the levels attribute consists of the 
+    // levels in the order of the codes.
+    virtual void finish();
     
   private:
     bool trim_;
-    mutable std::map<std::string, int> levels_;
+    bool unknown_to_na_;
+    std::shared_ptr<LevelDictionary> levels_;
+    // levels attribute of the previous vector; only levels that have been 
+    // added since are converted to R strings
+    Rcpp::CharacterVector labels_;
     Rcpp::IntegerVector v;
     int* pv;
 };
@@ -16,8 +16,29 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "file.h"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <stdexcept>
+#include <thread>
+#include <sys/stat.h>
+
+namespace {
+  const uint64_t MIN_PART_SIZE = 16*1024*1024;
+  const unsigned int COUNT_BUFFER_SIZE = 1000000;
+
+  // Count the line endings in a part of a file; used as the thread function 
+  // of count_newlines. Exceptions can not leave a thread; these are stored
+  // in error.
+  void count_part(const std::string* filename, uint64_t begin, uint64_t end, 
+      uint64_t* count, std::string* error) {
+    try {
+      *count = count_newlines(*filename, begin, end);
+    } catch(const std::exception& e) {
+      *error = e.what();
+    }
+  }
+}
 
 int determine_linebreak(const std::string& filename) {
   std::fstream file(filename.c_str(), std::ios_base::in|std::ios_base::binary);
@@ -49,3 +70,88 @@ bool has_bom(const std::string& filename) {
   return true;
 }
 
+bool get_file_identity(const std::string& filename, FileIdentity& identity) {
+#ifdef _WIN32
+  // st_size of stat is 32 bit on windows
+  struct _stat64 st;
+  if (_stat64(filename.c_str(), &st) != 0) return false;
+  int64_t nsec = 0;
+#else
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) return false;
+#if defined(__APPLE__)
+  int64_t nsec = st.st_mtimespec.tv_nsec;
+#elif defined(st_mtime)
+  // st_mtime is defined as st_mtim.tv_sec when stat has a timespec
+  int64_t nsec = st.st_mtim.tv_nsec;
+#else
+  int64_t nsec = 0;
+#endif
+#endif
+  identity.size = st.st_size;
+  identity.mtime = static_cast<int64_t>(st.st_mtime)*1000000000 + nsec;
+  return true;
+}
+
+bool operator==(const FileIdentity& a, const FileIdentity& b) {
+  return a.size == b.size && a.mtime == b.mtime;
+}
+
+std::vector<uint64_t> split_range(uint64_t begin, uint64_t end, 
+    unsigned int nparts) {
+  uint64_t size = end > begin ? end - begin : 0;
+  if (nparts > size / MIN_PART_SIZE) nparts = size / MIN_PART_SIZE;
+  if (nparts < 1) nparts = 1;
+  std::vector<uint64_t> bounds;
+  for (unsigned int i = 0; i < nparts; ++i) 
+    bounds.push_back(begin + (size / nparts) * i);
+  bounds.push_back(begin + size);
+  return bounds;
+}
+
+uint64_t count_newlines(const std::string& filename, uint64_t begin, 
+    uint64_t end) {
+  std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
+  if (input.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  input.seekg(static_cast<std::streamoff>(begin), std::ios::beg);
+  std::vector<char> buffer(COUNT_BUFFER_SIZE);
+  uint64_t n = 0;
+  uint64_t position = begin;
+  while (position < end && input) {
+    uint64_t size = std::min<uint64_t>(COUNT_BUFFER_SIZE, end - position);
+    input.read(&buffer[0], size);
+    unsigned int nread = input.gcount();
+    if (nread == 0) break;
+    const char* p = &buffer[0];
+    const char* pend = p + nread;
+    while ((p = static_cast<const char*>(std::memchr(p, '\n', pend - p)))) {
+      ++p;
+      ++n;
+    }
+    position += nread;
+  }
+  return n;
+}
+
+std::vector<uint64_t> count_newlines(const std::string& filename, 
+    const std::vector<uint64_t>& bounds) {
+  unsigned int nparts = bounds.size() - 1;
+  std::vector<uint64_t> counts(nparts);
+  std::vector<std::string> errors(nparts);
+  std::vector<std::thread> threads;
+  threads.reserve(nparts);
+  for (unsigned int i = 1; i < nparts; ++i) {
+    try {
+      threads.push_back(std::thread(count_part, &filename, bounds[i], 
+        bounds[i+1], &counts[i], &errors[i]));
+    } catch(const std::exception&) {
+      count_part(&filename, bounds[i], bounds[i+1], &counts[i], &errors[i]);
+    }
+  }
+  count_part(&filename, bounds[0], bounds[1], &counts[0], &errors[0]);
+  for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+    p->join();
+  for (std::vector<std::string>::const_iterator p = errors.begin(); p != errors.end(); ++p)
+    if (!p->empty()) throw std::runtime_error(*p);
+  return counts;
+}
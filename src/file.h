@@ -19,8 +19,39 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #define file_h
 
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 int determine_linebreak(const std::string& filename);
 bool has_bom(const std::string& filename);
 
+// Size and modification time (in nanoseconds since the epoch; with second
+// resolution on platforms that do not offer more) of a file; used to check 
+// whether information cached for a file is still valid. The size is not used 
+// to determine the end of the file.
+struct FileIdentity {
+  uint64_t size;
+  int64_t mtime;
+};
+
+bool get_file_identity(const std::string& filename, FileIdentity& identity);
+bool operator==(const FileIdentity& a, const FileIdentity& b);
+
+// Split the byte range [begin, end) into at most nparts parts of about equal 
+// size. Parts are not made smaller than 16 MB. Returns the boundaries of the
+// parts; part i is [result[i], result[i+1]).
+std::vector<uint64_t> split_range(uint64_t begin, uint64_t end, 
+  unsigned int nparts);
+
+// End of a byte range that extends to the end of the file.
+const uint64_t END_OF_FILE = static_cast<uint64_t>(-1);
+
+// Count the number of line endings in the byte range [begin, end) of a file.
+uint64_t count_newlines(const std::string& filename, uint64_t begin, 
+  uint64_t end);
+// Count the number of line endings in each of the parts defined by bounds
+// (see split_range). Each part is counted in a separate thread.
+std::vector<uint64_t> count_newlines(const std::string& filename, 
+  const std::vector<uint64_t>& bounds);
+
 #endif
@@ -0,0 +1,202 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filter.h"
+#include "reader.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+  // Convert the fields [0, n) to values; fields that can not be converted 
+  // are missing. The failures on selected lines are handled by the column,
+  // which logs or throws. Returns the index of the first failure that is 
+  // thrown (and sets error) or n.
+  template<typename Converter, typename Fields>
+  unsigned int convert_condition(const Column* column, 
+      const Converter& converter, const Fields& fields, unsigned int n, 
+      uint64_t line, const unsigned char* selected, 
+      typename Converter::value_type na, 
+      typename Converter::value_type* values, std::string& error) {
+    for (unsigned int j = convert_fields(converter, fields, 0, n, values); 
+        j < n; j = convert_fields(converter, fields, j + 1, n, values)) {
+      values[j] = na;
+      if (!selected[j]) continue;
+      try {
+        column->get_double(fields.buffer(j), fields.length(j), line + j);
+      } catch(const std::exception& e) {
+        error = e.what();
+        return j;
+      }
+    }
+    return n;
+  }
+}
+
+Filter::Filter() {
+}
+
+void Filter::add_condition(const Column* column, Operator op, 
+    const std::vector<double>& values) {
+  const IntColumn* integer = dynamic_cast<const IntColumn*>(column);
+  const DoubleColumn* real = dynamic_cast<const DoubleColumn*>(column);
+  if (!integer && !real)
+    throw std::runtime_error("Numeric condition on a categorical or string column.");
+  if (op == RANGE && values.size() != 2)
+    throw std::runtime_error("A range condition needs two values.");
+  if (op != IN && op != RANGE && values.size() != 1)
+    throw std::runtime_error("A comparison needs one value.");
+  // NaN can not be compared; the values of IN would not be sorted
+  for (std::vector<double>::const_iterator p = values.begin(); 
+      p != values.end(); ++p) 
+    if (ISNAN(*p)) throw std::runtime_error("Values of conditions should not be missing.");
+  Condition condition;
+  condition.column = column;
+  condition.op = op;
+  condition.numeric = true;
+  condition.integer = integer != 0;
+  condition.decimal_seperator = real ? real->get_decimal_seperator() : '.';
+  condition.values = values;
+  condition.trim = false;
+  condition.factor = false;
+  // values of IN are looked up using a binary search
+  if (op == IN) std::sort(condition.values.begin(), condition.values.end());
+  conditions_.push_back(condition);
+}
+
+void Filter::add_condition(const Column* column, Operator op, 
+    const std::vector<std::string>& values) {
+  const FactorColumn* factor = dynamic_cast<const FactorColumn*>(column);
+  const StringColumn* character = dynamic_cast<const StringColumn*>(column);
+  if (!factor && !character)
+    throw std::runtime_error("String condition on a numeric column.");
+  if (op != EQUAL && op != NOT_EQUAL && op != IN)
+    throw std::runtime_error("Only ==, != and in are supported for categorical and string columns.");
+  if (op != IN && values.size() != 1)
+    throw std::runtime_error("A comparison needs one value.");
+  Condition condition;
+  condition.column = column;
+  condition.op = op;
+  condition.numeric = false;
+  condition.integer = false;
+  condition.decimal_seperator = '.';
+  condition.trim = factor ? factor->get_trim() : character->get_trim();
+  condition.factor = factor != 0;
+  for (std::vector<std::string>::const_iterator p = values.begin(); 
+      p != values.end(); ++p) 
+    condition.labels.add(p->data(), p->size());
+  conditions_.push_back(condition);
+}
+
+std::vector<unsigned int> Filter::get_columns() const {
+  std::vector<unsigned int> columns;
+  for (std::vector<Condition>::const_iterator p = conditions_.begin(); 
+      p != conditions_.end(); ++p) {
+    columns.push_back(p->column->get_column_number());
+  }
+  return columns;
+}
+
+template<typename Fields>
+unsigned int Filter::select(const std::vector<Fields>& fields, unsigned int n, 
+    uint64_t line, unsigned char* selected, std::string& error) const {
+  // lines after a failure that is thrown are not evaluated by the following
+  // conditions
+  for (unsigned int k = 0; k < conditions_.size(); ++k) 
+    n = select(conditions_[k], fields[k], n, line, selected, error);
+  return n;
+}
+
+template<typename Fields>
+unsigned int Filter::select(const Condition& condition, const Fields& fields,
+    unsigned int n, uint64_t line, unsigned char* selected, 
+    std::string& error) const {
+  if (!condition.numeric) return select_labels(condition, fields, n, selected);
+  std::vector<double> values(n);
+  if (condition.integer) {
+    std::vector<int> ints(n);
+    n = convert_condition(condition.column, IntConverter(NA_INTEGER), fields,
+      n, line, selected, NA_INTEGER, ints.data(), error);
+    for (unsigned int j = 0; j < n; ++j) 
+      values[j] = ints[j] == NA_INTEGER ? NA_REAL : ints[j];
+  } else {
+    n = convert_condition(condition.column, 
+      DoubleConverter(NA_REAL, condition.decimal_seperator), fields, n, line,
+      selected, NA_REAL, values.data(), error);
+  }
+  for (unsigned int j = 0; j < n; ++j) 
+    if (selected[j] && !pass(condition, values[j])) selected[j] = 0;
+  return n;
+}
+
+template<typename Fields>
+unsigned int Filter::select_labels(const Condition& condition, 
+    const Fields& fields, unsigned int n, unsigned char* selected) const {
+  const FactorColumn* factor = condition.factor ? 
+    static_cast<const FactorColumn*>(condition.column) : 0;
+  for (unsigned int j = 0; j < n; ++j) {
+    if (!selected[j]) continue;
+    const char* buffer = fields.buffer(j);
+    unsigned int length = fields.length(j);
+    // missing values of factors (empty values and, depending on the 
+    // column, unknown levels) do not pass
+    if (factor && factor->is_na(buffer, length)) {
+      selected[j] = 0;
+      continue;
+    }
+    if (condition.trim) trim_blanks(buffer, length);
+    bool found = condition.labels.find(buffer, length) != 0;
+    if (found == (condition.op == NOT_EQUAL)) selected[j] = 0;
+  }
+  return n;
+}
+
+template unsigned int Filter::select(const std::vector<SpanFields>&, 
+  unsigned int, uint64_t, unsigned char*, std::string&) const;
+template unsigned int Filter::select(const std::vector<StripeFields>&, 
+  unsigned int, uint64_t, unsigned char*, std::string&) const;
+
+bool Filter::pass(const Reader& reader) const {
+  std::vector<FieldSpan> spans(conditions_.size());
+  std::vector<SpanFields> fields;
+  for (unsigned int k = 0; k < conditions_.size(); ++k) {
+    unsigned int column = conditions_[k].column->get_column_number();
+    spans[k].buffer = reader.get_buffer(column);
+    spans[k].length = reader.get_length(column);
+    fields.push_back(SpanFields(&spans[k]));
+  }
+  unsigned char selected = 1;
+  std::string error;
+  if (select(fields, 1, reader.get_current_line() - 1, &selected, error) == 0)
+    throw std::runtime_error(error);
+  return selected != 0;
+}
+
+bool Filter::pass(const Condition& condition, double value) const {
+  if (ISNAN(value)) return false;
+  const std::vector<double>& values = condition.values;
+  switch (condition.op) {
+    case EQUAL: return value == values[0];
+    case NOT_EQUAL: return value != values[0];
+    case LESS: return value < values[0];
+    case LESS_EQUAL: return value <= values[0];
+    case GREATER: return value > values[0];
+    case GREATER_EQUAL: return value >= values[0];
+    case RANGE: return value >= values[0] && value <= values[1];
+    case IN: return std::binary_search(values.begin(), values.end(), value);
+  }
+  return false;
+}
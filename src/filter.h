@@ -0,0 +1,106 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef filter_h
+#define filter_h
+
+#include "column.h"
+#include "conversion.h"
+#include "leveldictionary.h"
+#include <string>
+#include <vector>
+
+class Reader;
+
+// Row filter evaluated on the fields of a block of lines before the columns
+// are converted. A line passes when it satisfies all conditions. Lines for
+// which a column in a condition is missing do not pass.
+class Filter {
+  public:
+    enum Operator {
+      EQUAL = 0,
+      NOT_EQUAL = 1,
+      LESS = 2,
+      LESS_EQUAL = 3,
+      GREATER = 4,
+      GREATER_EQUAL = 5,
+      // value is in [values[0], values[1]]
+      RANGE = 6,
+      // value is one of values
+      IN = 7
+    };
+
+    Filter();
+
+    // Condition on the numeric value of an int or double column. 
+    void add_condition(const Column* column, Operator op, 
+      const std::vector<double>& values);
+    // Condition on a factor or string column. The values are compared to the 
+    // (trimmed when the column is trimmed) values in the file; only EQUAL, 
+    // NOT_EQUAL and IN are supported.
+    void add_condition(const Column* column, Operator op, 
+      const std::vector<std::string>& values);
+
+    bool empty() const { return conditions_.empty();}
+    // Numbers of the columns used in the conditions.
+    std::vector<unsigned int> get_columns() const;
+
+    // Evaluate the conditions on n lines; fields[k] contains the fields of 
+    // the column of condition k and line is the line number of the first
+    // line. selected[j] is set to 0 for the lines that do not pass; other
+    // elements are not changed. Fields that can not be converted do not pass
+    // and are logged once by their column. When failed conversions are not
+    // ignored, evaluation stops at the first such line: its index is 
+    // returned and error is set. Otherwise n is returned. Can be called 
+    // simultaneously from different threads. Instantiated for SpanFields and
+    // StripeFields.
+    template<typename Fields>
+    unsigned int select(const std::vector<Fields>& fields, unsigned int n, 
+      uint64_t line, unsigned char* selected, std::string& error) const;
+
+    // Returns true when the current line of reader passes all conditions. 
+    bool pass(const Reader& reader) const;
+
+  private:
+    struct Condition {
+      const Column* column;
+      Operator op;
+      bool numeric;
+      // numeric conditions
+      bool integer;
+      char decimal_seperator;
+      std::vector<double> values;
+      // string conditions; the labels are looked up without copying the 
+      // fields
+      bool trim;
+      bool factor;
+      LevelDictionary labels;
+    };
+
+    template<typename Fields>
+    unsigned int select(const Condition& condition, const Fields& fields,
+      unsigned int n, uint64_t line, unsigned char* selected, 
+      std::string& error) const;
+    template<typename Fields>
+    unsigned int select_labels(const Condition& condition, const Fields& fields,
+      unsigned int n, unsigned char* selected) const;
+    bool pass(const Condition& condition, double value) const;
+
+    std::vector<Condition> conditions_;
+};
+
+#endif
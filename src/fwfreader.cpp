@@ -18,64 +18,207 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #include "fwfreader.h"
 #include "file.h"
 #include "conversion.h"
+#include "filter.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <cassert>
 #include <stdexcept>
+#include <thread>
 
-FWFReader::FWFReader(const std::string& filename, unsigned int buffersize, unsigned int nlines) :
-  filename_(filename), stream_(filename_.c_str(), std::ios_base::in|std::ios::binary), 
-  offset_(0), linesize_(0), buffersize_(0), nlines_(nlines), buffer_(0), chars_in_buffer_(0),
-  current_index_(0), current_char_(0), line_(new char[linesize_])
+namespace {
+  // Number of bytes read for random access. Records within this number of
+  // bytes from the requested record are read along; these can be accessed 
+  // without reading when they are requested next. 
+  const unsigned int RANDOM_READ_SIZE = 4096;
+
+  // Blocks smaller than this number of lines per thread are read using one
+  // thread
+  const unsigned int MIN_LINES_PER_THREAD = 1000;
+  // Maximum number of records gathered at once by read_block; larger blocks
+  // are read in parts
+  const unsigned int MAX_BLOCK_SIZE = 100000;
+  // When the bytes the source reads for the fields (see Source::range_gap) 
+  // are less than 1/SPARSE_FRACTION of the records only these bytes are read
+  // from the file
+  const unsigned int SPARSE_FRACTION = 4;
+  // Fields of a record separated by less than this number of bytes are read
+  // as one range; copying a few bytes more is cheaper than an extra range
+  const unsigned int MAX_FIELD_GAP = 64;
+
+  // The part of the block handled by one thread: records [first, last). The
+  // (selected) records are assigned to the elements of the columns starting
+  // at element offset.
+  struct Chunk {
+    unsigned int offset;
+    unsigned int first;
+    unsigned int last;
+    // first record that has not been converted; either last or the record on
+    // which an error occurred
+    unsigned int end;
+    bool failed;
+    std::string error;
+  };
+
+  // Convert the records [first, last) of a column using the stripe of the
+  // column and assign them to the elements starting at element.
+  void convert_stripe(const FWFBlock* block, Column* column, unsigned int element,
+      unsigned int first, unsigned int last) {
+    unsigned int i = column->get_column_number();
+    // the last record of the file can be incomplete
+    unsigned int end = last;
+    if (end > first && block->get_length(end - 1, i) < block->get_width(i)) end--;
+    column->assign_stripe(element, block->get_buffer(first, i), 
+      block->get_width(i), end - first, block->first_line() + first + 1);
+    if (end < last) column->assign_at(element + end - first, 
+      block->get_buffer(end, i), block->get_length(end, i), 
+      block->first_line() + end + 1);
+  }
+
+  // Convert the records of the chunk; when selected is given only the 
+  // records j for which selected[j] is nonzero.
+  void convert_chunk(const FWFBlock* block, const std::vector<Column*>* columns,
+      const unsigned char* selected, Chunk* chunk) {
+    try {
+      // runs of selected records are converted one column at a time
+      unsigned int element = chunk->offset;
+      unsigned int first = chunk->first;
+      while (first < chunk->last) {
+        if (selected && !selected[first]) {
+          ++first;
+          continue;
+        }
+        unsigned int last = selected ? first + 1 : chunk->last;
+        while (last < chunk->last && selected[last]) ++last;
+        for (std::vector<Column*>::const_iterator p = columns->begin();
+            p != columns->end(); ++p) 
+          convert_stripe(block, *p, element, first, last);
+        element += last - first;
+        first = last;
+      }
+      chunk->end = chunk->last;
+      return;
+    } catch(const std::exception& e) {
+      // errors should be reported for the first line with an error; convert
+      // the chunk again line by line to find that line
+    }
+    unsigned int record = chunk->first;
+    unsigned int element = chunk->offset;
+    try {
+      for (; record < chunk->last; ++record) {
+        if (selected && !selected[record]) continue;
+        for (std::vector<Column*>::const_iterator p = columns->begin();
+            p != columns->end(); ++p) {
+          unsigned int i = (*p)->get_column_number();
+          (*p)->assign_at(element, block->get_buffer(record, i), 
+            block->get_length(record, i), block->first_line() + record + 1);
+        }
+        ++element;
+      }
+    } catch(const std::exception& e) {
+      chunk->failed = true;
+      chunk->error = e.what();
+    }
+    chunk->end = record;
+  }
+
+  // Evaluate filter on the records of the chunk; columns are the columns of
+  // the conditions. When a field of a condition can not be converted, end is
+  // set to its record.
+  void select_chunk(const FWFBlock* block, const Filter* filter, 
+      const std::vector<unsigned int>* columns, unsigned char* selected, 
+      Chunk* chunk) {
+    unsigned int first = chunk->first;
+    // the last record of the file can be incomplete; it is evaluated 
+    // separately
+    unsigned int end = chunk->last;
+    std::vector<StripeFields> stripes;
+    for (std::vector<unsigned int>::const_iterator p = columns->begin(); 
+        p != columns->end(); ++p) {
+      stripes.push_back(StripeFields(block->get_buffer(first, *p), 
+        block->get_width(*p)));
+      if (end > first && block->get_length(chunk->last - 1, *p) < 
+          block->get_width(*p)) end = chunk->last - 1;
+    }
+    chunk->end = first + filter->select(stripes, end - first, 
+      block->first_line() + first + 1, selected + first, chunk->error);
+    if (chunk->end == end && end < chunk->last) {
+      std::vector<FieldSpan> spans(columns->size());
+      std::vector<SpanFields> last;
+      for (unsigned int k = 0; k < columns->size(); ++k) {
+        spans[k].buffer = block->get_buffer(end, (*columns)[k]);
+        spans[k].length = block->get_length(end, (*columns)[k]);
+        last.push_back(SpanFields(&spans[k]));
+      }
+      chunk->end += filter->select(last, 1, block->first_line() + end + 1, 
+        selected + end, chunk->error);
+    }
+    chunk->failed = chunk->end < chunk->last;
+  }
+}
+
+FWFReader::FWFReader(const std::string& filename, unsigned int buffersize, 
+    uint64_t nlines, bool use_mmap, unsigned int read_ahead) :
+  filename_(filename), source_(0), offset_(0), linesize_(0), buffersize_(0), 
+  nlines_(nlines), buffer_(0), buffer_line_(0), chars_in_buffer_(0), 
+  current_index_(0), 
+  current_char_(0), line_(0), line_length_(0), sparse_supported_(true),
+  sparse_size_(0)
 {
-  if (stream_.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  source_ = open_source(filename, use_mmap, read_ahead);
+  // calling read_ranges without ranges checks whether it is supported
+  sparse_supported_ = source_->read_ranges(byte_ranges_);
   // init buffers
-  offset_ = has_bom(filename) ? 3 : 0;
-  linesize_ = determine_linesize(filename);
+  offset_ = has_bom(source_) ? 3 : 0;
+  linesize_ = determine_linesize();
   buffersize_ = linesize_*buffersize;
-  buffer_ = new char[buffersize_];
-  // init first line
-  line_ = new char[linesize_];
-  line_[linesize_-1] = 0;
-  line_[0] = 0;
-  if (nlines == 0) nlines_ = determine_nlines();
   reset();
 }
 
 FWFReader::~FWFReader() {
-  if (stream_) stream_.close();
-  delete [] buffer_;
-  delete [] line_;
+  delete source_;
 }
 
 void FWFReader::reset() {
-  stream_.clear();
-  stream_.seekg(offset_, std::ios::beg);
-  current_line_ = 0;
-  next_block();
+  seek_line(0);
 }
 
 bool FWFReader::next_line() {
-  if (current_index_ >= chars_in_buffer_) next_block();
+  if (current_index_ >= chars_in_buffer_) {
+    source_->set_access(Source::SEQUENTIAL);
+    next_block();
+  }
   if (!current_char_ || !chars_in_buffer_) return false;
-  std::strncpy(line_, current_char_, linesize_-1);
+  // the last line of the file can be shorter than the line size; make sure we
+  // don't read past the end of the block
+  unsigned int n = chars_in_buffer_ - current_index_;
+  if (n > linesize_-1) n = linesize_-1;
+  line_ = current_char_;
+  line_length_ = n;
   current_char_ += linesize_;
   current_index_ += linesize_;
   current_line_++;
   return true;
 }
 
-bool FWFReader::goto_line(unsigned int line) {
-  // TODO: check if line is valid?? Depends on how seekg works
-  stream_.clear();
-  std::ios::pos_type pos = static_cast<std::ios::pos_type>(line) * linesize_;
-  stream_.seekg(offset_ + pos, std::ios::beg);
-  next_block();
+bool FWFReader::goto_line(uint64_t line) {
+  // when the line is in the current buffer (e.g. when reading a sorted set of
+  // lines that are close together) no reading is necessary
+  uint64_t nrecords = (chars_in_buffer_ + linesize_ - 1)/linesize_;
+  if (!buffer_ || line < buffer_line_ || (line - buffer_line_) >= nrecords) 
+    read_random(line);
+  current_index_ = (line - buffer_line_) * linesize_;
+  current_char_ = buffer_ + current_index_;
   current_line_ = line;
   return next_line();
 }
 
-unsigned int FWFReader::get_current_line() const { 
+uint64_t FWFReader::nlines() const {
+  if (nlines_ == 0) nlines_ = determine_nlines();
+  return nlines_;
+}
+
+uint64_t FWFReader::get_current_line() const { 
   return current_line_+1;
 }
 
@@ -84,7 +227,303 @@ const char* FWFReader::get_buffer(unsigned int i) const {
 }
 
 unsigned int FWFReader::get_length(unsigned int i) const {
-  return nchar_[i];
+  return field_length(i, line_length_);
+}
+
+unsigned int FWFReader::read_block(const std::vector<Column*>& columns, 
+    unsigned int nlines, const Filter* filter) {
+  if (filter && filter->empty()) filter = 0;
+  std::vector<unsigned int> column_numbers;
+  std::vector<Column*> parallel_columns;
+  std::vector<Column*> serial_columns;
+  for (std::vector<Column*>::const_iterator p = columns.begin(); p != columns.end(); ++p) {
+    if ((*p)->thread_safe()) parallel_columns.push_back(*p);
+    else serial_columns.push_back(*p);
+    column_numbers.push_back((*p)->get_column_number());
+  }
+  // the fields of the columns of the conditions are read along
+  std::vector<unsigned int> filter_columns;
+  if (filter) filter_columns = filter->get_columns();
+  column_numbers.insert(column_numbers.end(), filter_columns.begin(), 
+    filter_columns.end());
+  unsigned int nread = 0;
+  while (nread < nlines) {
+    unsigned int n = read_records(block_, std::min(nlines - nread, MAX_BLOCK_SIZE),
+      column_numbers);
+    if (n == 0) break;
+    if (!filter) {
+      nread += convert_block(block_, parallel_columns, serial_columns, nread);
+      continue;
+    }
+    selected_.assign(n, 1);
+    std::string error;
+    unsigned int end = select_records(block_, *filter, filter_columns, 
+      &selected_[0], error);
+    nread += convert_block(block_, parallel_columns, serial_columns, nread, 
+      &selected_[0], end);
+    // on an error continue reading after the line with the error
+    if (end < n) {
+      seek_line(block_.first_line() + end + 1);
+      throw std::runtime_error(error);
+    }
+  }
+  return nread;
+}
+
+unsigned int FWFReader::select_records(const FWFBlock& block, 
+    const Filter& filter, const std::vector<unsigned int>& columns, 
+    unsigned char* selected, std::string& error) const {
+  unsigned int n = block.size();
+  unsigned int nthreads = std::min(get_threads(), n / MIN_LINES_PER_THREAD);
+  if (nthreads < 1) nthreads = 1;
+  unsigned int chunk_size = (n + nthreads - 1) / nthreads;
+  std::vector<Chunk> chunks(nthreads);
+  for (unsigned int i = 0; i < nthreads; ++i) {
+    chunks[i].offset = 0;
+    chunks[i].first = std::min(i * chunk_size, n);
+    chunks[i].last = std::min((i + 1) * chunk_size, n);
+    chunks[i].end = chunks[i].first;
+    chunks[i].failed = false;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (unsigned int i = 1; i < nthreads; ++i) {
+    try {
+      threads.push_back(std::thread(select_chunk, &block, &filter, &columns, 
+        selected, &chunks[i]));
+    } catch(const std::exception&) {
+      select_chunk(&block, &filter, &columns, selected, &chunks[i]);
+    }
+  }
+  select_chunk(&block, &filter, &columns, selected, &chunks[0]);
+  for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+    p->join();
+  for (std::vector<Chunk>::const_iterator chunk = chunks.begin(); 
+      chunk != chunks.end(); ++chunk) {
+    if (chunk->failed) {
+      error = chunk->error;
+      return chunk->end;
+    }
+  }
+  return n;
+}
+
+unsigned int FWFReader::convert_block(const FWFBlock& block, 
+    const std::vector<Column*>& parallel_columns, 
+    const std::vector<Column*>& serial_columns, unsigned int offset,
+    const unsigned char* selected, unsigned int nrecords) {
+  if (!selected) nrecords = block.size();
+  unsigned int nthreads = std::min(get_threads(), nrecords / MIN_LINES_PER_THREAD);
+  if (nthreads < 1) nthreads = 1;
+  unsigned int chunk_size = (nrecords + nthreads - 1) / nthreads;
+  std::vector<Chunk> chunks(nthreads + 1);
+  unsigned int element = offset;
+  for (unsigned int i = 0; i < nthreads; ++i) {
+    chunks[i].offset = element;
+    chunks[i].first = std::min(i * chunk_size, nrecords);
+    chunks[i].last = std::min((i + 1) * chunk_size, nrecords);
+    chunks[i].end = chunks[i].first;
+    chunks[i].failed = false;
+    element += chunks[i].last - chunks[i].first;
+    if (selected) element -= std::count(selected + chunks[i].first, 
+      selected + chunks[i].last, 0);
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads);
+  for (unsigned int i = 1; i < nthreads; ++i) {
+    try {
+      threads.push_back(std::thread(convert_chunk, &block, &parallel_columns, 
+        selected, &chunks[i]));
+    } catch(const std::exception&) {
+      convert_chunk(&block, &parallel_columns, selected, &chunks[i]);
+    }
+  }
+  convert_chunk(&block, &parallel_columns, selected, &chunks[0]);
+  for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+    p->join();
+  // the remaining columns are assigned in order by the last chunk, which 
+  // covers the complete block
+  if (!serial_columns.empty()) {
+    Chunk& chunk = chunks[nthreads];
+    chunk.offset = offset;
+    chunk.first = 0;
+    chunk.last = nrecords;
+    chunk.end = 0;
+    chunk.failed = false;
+    bool failed = false;
+    for (unsigned int i = 0; i < nthreads; ++i) failed = failed || chunks[i].failed;
+    if (!failed) convert_chunk(&block, &serial_columns, selected, &chunk);
+  }
+  // on an error continue reading after the line with the error
+  for (std::vector<Chunk>::const_iterator chunk = chunks.begin(); 
+      chunk != chunks.end(); ++chunk) {
+    if (chunk->failed) {
+      seek_line(block.first_line() + chunk->end + 1);
+      throw std::runtime_error(chunk->error);
+    }
+  }
+  return element - offset;
+}
+
+unsigned int FWFReader::read_records(FWFBlock& block, unsigned int nlines,
+    const std::vector<unsigned int>& columns) {
+  block.first_line_ = current_line_;
+  block.nrecords_ = 0;
+  block.stripes_.resize(start_.size());
+  // columns that extend beyond the end of the line are truncated
+  block.widths_.resize(start_.size());
+  for (unsigned int i = 0; i < start_.size(); ++i) 
+    block.widths_[i] = field_length(i, linesize_-1);
+  block.last_lengths_ = block.widths_;
+  std::vector<unsigned int> used;
+  for (std::vector<unsigned int>::const_iterator p = columns.begin(); 
+      p != columns.end(); ++p) {
+    if (std::find(used.begin(), used.end(), *p) != used.end()) continue;
+    used.push_back(*p);
+    block.stripes_[*p].clear();
+  }
+  bool sparse = use_sparse(block, used);
+  while (block.nrecords_ < nlines) {
+    // records that are still in the buffer are used before reading only the
+    // fields of the records
+    if (sparse && current_index_ >= chars_in_buffer_) {
+      unsigned int n = read_sparse(block, used, nlines - block.nrecords_);
+      // nothing is read at the end of the file or when the source does not
+      // support reading ranges
+      if (n == 0 && sparse_supported_) break;
+      sparse = sparse_supported_;
+      continue;
+    }
+    if (current_index_ >= chars_in_buffer_) {
+      source_->set_access(Source::SEQUENTIAL);
+      next_block();
+    }
+    if (!current_char_ || !chars_in_buffer_) break;
+    // the last record of the file can be incomplete
+    unsigned int available = chars_in_buffer_ - current_index_;
+    unsigned int n = std::min((available + linesize_ - 1)/linesize_, 
+      nlines - block.nrecords_);
+    unsigned int last_length = std::min(available - (n-1)*linesize_, linesize_-1);
+    gather(block, used, current_char_, linesize_, start_, n, last_length);
+    current_char_ += n*linesize_;
+    current_index_ += n*linesize_;
+    current_line_ += n;
+  }
+  // the current record is not valid anymore
+  line_length_ = 0;
+  return block.nrecords_;
+}
+
+void FWFReader::gather(FWFBlock& block, const std::vector<unsigned int>& columns,
+    const char* records, unsigned int stride, 
+    const std::vector<unsigned int>& starts, unsigned int n, 
+    unsigned int last_length) {
+  for (std::vector<unsigned int>::const_iterator p = columns.begin(); 
+      p != columns.end(); ++p) {
+    unsigned int width = block.widths_[*p];
+    if (width == 0) continue;
+    std::vector<char>& stripe = block.stripes_[*p];
+    size_t size = stripe.size();
+    stripe.resize(size + static_cast<size_t>(n)*width);
+    char* dest = &stripe[size];
+    const char* src = records + starts[*p];
+    for (unsigned int j = 1; j < n; ++j, dest += width, src += stride) 
+      std::memcpy(dest, src, width);
+    block.last_lengths_[*p] = field_length(*p, last_length);
+    std::memcpy(dest, src, block.last_lengths_[*p]);
+  }
+  block.nrecords_ += n;
+}
+
+bool FWFReader::use_sparse(const FWFBlock& block, 
+    const std::vector<unsigned int>& columns) {
+  if (!sparse_supported_) return false;
+  // merge the fields of the columns into ranges of bytes within a record
+  std::vector<std::pair<unsigned int, unsigned int> > fields;
+  for (std::vector<unsigned int>::const_iterator p = columns.begin(); 
+      p != columns.end(); ++p) {
+    if (block.widths_[*p] > 0) 
+      fields.push_back(std::make_pair(start_[*p], start_[*p] + block.widths_[*p]));
+  }
+  std::sort(fields.begin(), fields.end());
+  sparse_ranges_.clear();
+  unsigned int covered = 0;
+  for (unsigned int i = 0; i < fields.size(); ++i) {
+    if (!sparse_ranges_.empty() && 
+        fields[i].first < sparse_ranges_.back().second + MAX_FIELD_GAP) {
+      sparse_ranges_.back().second = std::max(sparse_ranges_.back().second, 
+        fields[i].second);
+    } else {
+      sparse_ranges_.push_back(fields[i]);
+    }
+  }
+  // position of the fields in the records read by read_sparse; these contain
+  // only the ranges
+  sparse_starts_.assign(start_.size(), 0);
+  for (unsigned int i = 0; i < sparse_ranges_.size(); ++i) {
+    for (std::vector<unsigned int>::const_iterator p = columns.begin(); 
+        p != columns.end(); ++p) {
+      if (start_[*p] >= sparse_ranges_[i].first && start_[*p] < sparse_ranges_[i].second)
+        sparse_starts_[*p] = covered + start_[*p] - sparse_ranges_[i].first;
+    }
+    covered += sparse_ranges_[i].second - sparse_ranges_[i].first;
+  }
+  sparse_size_ = covered;
+  if (covered == 0) return false;
+  // the source also reads the bytes of gaps between ranges (including the gap
+  // between the last range of a record and the first of the next) that are
+  // not larger than its range_gap; when these have to be read anyway, 
+  // reading complete blocks is faster
+  unsigned int read = linesize_;
+  for (unsigned int i = 0; i < sparse_ranges_.size(); ++i) {
+    unsigned int gap = (i+1) < sparse_ranges_.size() ? 
+      sparse_ranges_[i+1].first - sparse_ranges_[i].second :
+      linesize_ - sparse_ranges_[i].second + sparse_ranges_[0].first;
+    if (gap > source_->range_gap()) read -= gap;
+  }
+  return read*SPARSE_FRACTION < linesize_;
+}
+
+unsigned int FWFReader::read_sparse(FWFBlock& block, 
+    const std::vector<unsigned int>& columns, unsigned int nlines) {
+  // the last record of the file can be incomplete
+  uint64_t size = source_->size();
+  uint64_t position = offset_ + current_line_*linesize_;
+  if (position >= size) return 0;
+  uint64_t nleft = (size - position + linesize_ - 1)/linesize_;
+  unsigned int n = std::min(nlines, buffersize_/linesize_);
+  if (nleft < n) n = nleft;
+  unsigned int last_length = std::min<uint64_t>(size - position - 
+    static_cast<uint64_t>(n-1)*linesize_, linesize_-1);
+  sparse_buffer_.resize(static_cast<size_t>(n)*sparse_size_);
+  byte_ranges_.clear();
+  for (unsigned int j = 0; j < n; ++j, position += linesize_) {
+    unsigned int length = (j + 1) == n ? last_length : linesize_;
+    char* dest = &sparse_buffer_[static_cast<size_t>(j)*sparse_size_];
+    for (unsigned int i = 0; i < sparse_ranges_.size(); ++i) {
+      unsigned int begin = sparse_ranges_[i].first;
+      unsigned int end = std::min(sparse_ranges_[i].second, length);
+      if (end <= begin) break;
+      ByteRange range = {position + begin, end - begin, dest};
+      byte_ranges_.push_back(range);
+      dest += end - begin;
+    }
+  }
+  source_->set_access(Source::RANDOM);
+  if (!source_->read_ranges(byte_ranges_)) {
+    sparse_supported_ = false;
+    return 0;
+  }
+  gather(block, columns, &sparse_buffer_[0], sparse_size_, sparse_starts_, n, 
+    last_length);
+  // the buffer of the reader no longer follows the position in the file; 
+  // sequential reading continues after the records read
+  current_line_ += n;
+  source_->seek(offset_ + current_line_*linesize_);
+  chars_in_buffer_ = 0;
+  current_index_ = 0;
+  current_char_ = 0;
+  return n;
 }
 
 const DoubleColumn* FWFReader::add_double_column(unsigned int width) {
@@ -125,33 +564,46 @@ void FWFReader::add_column(unsigned int nchar) {
 }
 
 void FWFReader::next_block() {
+  buffer_ = source_->next_block(buffersize_, chars_in_buffer_);
+  buffer_line_ = current_line_;
+  current_char_ = buffer_;
+  current_index_ = 0;
+}
+
+void FWFReader::read_random(uint64_t line) {
+  unsigned int size = (RANDOM_READ_SIZE/linesize_) * linesize_;
+  if (size < linesize_) size = linesize_;
+  if (size > buffersize_) size = buffersize_;
+  source_->set_access(Source::RANDOM);
+  source_->seek(offset_ + line * linesize_);
+  buffer_ = source_->next_block(size, chars_in_buffer_);
+  buffer_line_ = line;
+}
+
+void FWFReader::seek_line(uint64_t line) {
+  source_->set_access(Source::SEQUENTIAL);
+  source_->seek(offset_ + line * linesize_);
+  current_line_ = line;
+  // the block is read when the first record is needed; read_records can then
+  // read only the fields of the records instead
+  chars_in_buffer_ = 0;
+  current_index_ = 0;
   current_char_ = 0;
-  if (stream_.good()) {
-    stream_.read(buffer_, buffersize_);
-    chars_in_buffer_ = stream_.gcount();
-    current_char_ = buffer_;
-    current_index_ = 0;
-  }
 }
 
-unsigned int FWFReader::determine_linesize(const std::string& filename) {
-  std::ifstream stream(filename.c_str(), std::ios_base::in|std::ios::binary);
-  stream.seekg(offset_, std::ios::beg);
-  char c;
+unsigned int FWFReader::determine_linesize() {
+  SourceStream stream(source_, offset_);
   unsigned int linesize = 0;
-  while (stream.get(c)) {
+  int c;
+  while ((c = stream.get()) != EOF) {
     linesize++;
     if (c == '\n') break;
   }
-  stream.close();
   return linesize;
 }
 
-unsigned int FWFReader::determine_nlines() {
-  stream_.clear();
-  stream_.seekg(0, std::ios::end);
-  std::ios::pos_type nbytes = stream_.tellg();
-  reset();
+uint64_t FWFReader::determine_nlines() const {
+  uint64_t nbytes = source_->size();
   return (nbytes - offset_)/linesize_;
 }
 
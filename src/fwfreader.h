@@ -19,28 +19,89 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #define FWFREADER_H
 
 #include "reader.h" 
-#include <fstream>
+#include "source.h"
 #include <string>
+#include <utility>
 #include <vector>
 
+// Fields copied from a file by FWFReader::read_records. The fields of a 
+// column are stored consecutively in a stripe: the field of record j starts 
+// at get_width(i)*j. The block does not depend on the state of the reader; 
+// fields of different records can be converted simultaneously by different
+// threads.
+class FWFBlock {
+  public:
+    FWFBlock() : first_line_(0), nrecords_(0) {}
+
+    unsigned int size() const { return nrecords_;}
+    // line number (starting at 0) of the first record
+    uint64_t first_line() const { return first_line_;}
+
+    unsigned int get_width(unsigned int i) const { return widths_[i];}
+    const char* get_buffer(unsigned int record, unsigned int i) const {
+      return stripes_[i].data() + static_cast<size_t>(record)*widths_[i];
+    }
+    // Only the fields of the last record of a file can be shorter than the 
+    // width of the column. 
+    unsigned int get_length(unsigned int record, unsigned int i) const {
+      return record + 1 == nrecords_ ? last_lengths_[i] : widths_[i];
+    }
+
+  private:
+    friend class FWFReader;
+
+    uint64_t first_line_;
+    unsigned int nrecords_;
+    // stripes of the columns; empty for columns that are not read
+    std::vector< std::vector<char> > stripes_;
+    std::vector<unsigned int> widths_;
+    std::vector<unsigned int> last_lengths_;
+};
+
 class FWFReader : public Reader
 {
   public:
-    FWFReader(const std::string& filename, unsigned int buffersize = 1024, unsigned int nlines = 0);
+    FWFReader(const std::string& filename, unsigned int buffersize = 1024, 
+      uint64_t nlines = 0, bool use_mmap = false, 
+      unsigned int read_ahead = 0);
     ~FWFReader();
     
     unsigned int line_size() const { return linesize_;}
-    unsigned int nlines() const { return nlines_;}
+    // The number of lines is determined on first use; for compressed files
+    // this requires decompressing the complete file.
+    uint64_t nlines() const;
     
     void reset();
     bool next_line();
-    bool goto_line(unsigned int line);
+    bool goto_line(uint64_t line);
 
-    unsigned int get_current_line() const;
+    uint64_t get_current_line() const;
 
     const char* get_buffer(unsigned int i) const;
     unsigned int get_length(unsigned int i) const;
 
+    // Length of field i in a record of record_length bytes (without the line
+    // break).
+    unsigned int field_length(unsigned int i, unsigned int record_length) const {
+      if (start_[i] + nchar_[i] <= record_length) return nchar_[i];
+      // record is shorter than the line size (last line of the file)
+      return start_[i] < record_length ? record_length - start_[i] : 0;
+    }
+
+    // The fields of the block are gathered per column (see read_records) 
+    // and converted one column at a time. As records can be located without
+    // parsing the file, the records can be split over threads which convert
+    // them in parallel. With a filter, the conditions are evaluated on the 
+    // fields of the block after which only the records that pass are 
+    // converted.
+    unsigned int read_block(const std::vector<Column*>& columns,
+      unsigned int nlines, const Filter* filter = 0);
+
+    // Read at most nlines records starting at the current line and copy the
+    // fields of columns into block. Returns the number of records read.
+    unsigned int read_records(FWFBlock& block, unsigned int nlines, 
+      const std::vector<unsigned int>& columns);
+
     const DoubleColumn* add_double_column(unsigned int width);
     const IntColumn* add_int_column(unsigned int width);
     const StringColumn* add_string_column(unsigned int width);
@@ -51,28 +112,84 @@ class FWFReader : public Reader
     void add_column(unsigned int nchar);
 
     void next_block();
+    // Read the records starting at line for random access; reads at most a
+    // few kilobytes.
+    void read_random(uint64_t line);
+    // Position the reader at the start of line for sequential reading.
+    void seek_line(uint64_t line);
+    // Copy the fields of columns of n records into the stripes of block. 
+    // Record j starts at records + j*stride and field i at starts[i] within 
+    // the record. The last record is last_length bytes long.
+    void gather(FWFBlock& block, const std::vector<unsigned int>& columns,
+      const char* records, unsigned int stride, 
+      const std::vector<unsigned int>& starts, unsigned int n,
+      unsigned int last_length);
+    // Returns true when the source can read ranges of bytes and the bytes it
+    // reads for the fields of columns (which includes small gaps between the
+    // fields) are only a small part of the records. Determines the ranges
+    // read by read_sparse.
+    bool use_sparse(const FWFBlock& block, const std::vector<unsigned int>& columns);
+    // Read at most nlines records reading only the bytes of the fields of 
+    // columns from the file (see Source::read_ranges). Returns the number of
+    // records read.
+    unsigned int read_sparse(FWFBlock& block, 
+      const std::vector<unsigned int>& columns, unsigned int nlines);
+    // Evaluate filter on the records of block using multiple threads; see 
+    // Filter::select. columns are the columns of the conditions.
+    unsigned int select_records(const FWFBlock& block, const Filter& filter,
+      const std::vector<unsigned int>& columns, unsigned char* selected, 
+      std::string& error) const;
+    // Convert the fields in block and assign them to the columns starting at
+    // element offset. When selected is given, only the records j < nrecords
+    // for which selected[j] is nonzero are converted. The parallel columns 
+    // are converted using multiple threads; the serial columns afterwards. 
+    // Returns the number of records assigned.
+    unsigned int convert_block(const FWFBlock& block, 
+      const std::vector<Column*>& parallel_columns, 
+      const std::vector<Column*>& serial_columns, unsigned int offset, 
+      const unsigned char* selected = 0, unsigned int nrecords = 0);
     
-    unsigned int determine_linesize(const std::string& filename);
-    unsigned int determine_nlines();
+    unsigned int determine_linesize();
+    uint64_t determine_nlines() const;
     
   private:
     std::string filename_;
-    std::ifstream stream_;
-    std::ios::pos_type offset_;
+    Source* source_;
+    uint64_t offset_;
     
     unsigned int linesize_;
     unsigned int buffersize_;
-    unsigned int nlines_;
-    unsigned int current_line_;
+    mutable uint64_t nlines_;
+    uint64_t current_line_;
     
-    char* buffer_;
+    const char* buffer_;
+    // line of the first record in buffer_
+    uint64_t buffer_line_;
     unsigned int chars_in_buffer_;
     unsigned int current_index_;
-    char* current_char_;
+    const char* current_char_;
     
-    char* line_;
+    // current record; points into buffer_. The record is not copied and 
+    // remains valid until the next block is read. 
+    const char* line_;
+    // length of the current record without the line break; only the last 
+    // record of a file can be shorter than linesize_-1
+    unsigned int line_length_;
 
     std::vector<unsigned int> start_;
     std::vector<unsigned int> nchar_;
+    // used by read_block; kept to reuse the allocated memory
+    FWFBlock block_;
+    std::vector<unsigned char> selected_;
+    // reading of sparse records; see use_sparse and read_sparse. The ranges 
+    // [first, second) of a record are read and stored in sparse_buffer_ as
+    // records of sparse_size_ bytes.
+    bool sparse_supported_;
+    std::vector<std::pair<unsigned int, unsigned int> > sparse_ranges_;
+    std::vector<unsigned int> sparse_starts_;
+    unsigned int sparse_size_;
+    std::vector<char> sparse_buffer_;
+    std::vector<ByteRange> byte_ranges_;
 };
+
 #endif
@@ -0,0 +1,235 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gzipsource.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+  const unsigned int INPUT_BUFFER_SIZE = 262144;
+  const unsigned int WINDOW_SIZE = 32768;
+}
+
+// ============================================================================
+// ===                             GZIPINDEX                               ====
+// ============================================================================
+
+GzipIndex::GzipIndex(uint64_t span) : span_(span), complete_(false), size_(0) {
+}
+
+const GzipCheckpoint* GzipIndex::lookup(uint64_t position) const {
+  if (checkpoints_.empty() || checkpoints_[0].out > position) return 0;
+  // binary search for the last checkpoint with out <= position
+  unsigned int lo = 0;
+  unsigned int hi = checkpoints_.size();
+  while (hi - lo > 1) {
+    unsigned int mid = lo + (hi - lo)/2;
+    if (checkpoints_[mid].out <= position) lo = mid;
+    else hi = mid;
+  }
+  return &checkpoints_[lo];
+}
+
+bool GzipIndex::needs_checkpoint(uint64_t out) const {
+  if (checkpoints_.empty()) return out >= span_;
+  return out >= checkpoints_.back().out + span_;
+}
+
+void GzipIndex::add(const GzipCheckpoint& checkpoint) {
+  if (!needs_checkpoint(checkpoint.out)) return;
+  checkpoints_.push_back(checkpoint);
+}
+
+uint64_t GzipIndex::last() const {
+  return checkpoints_.empty() ? 0 : checkpoints_.back().out;
+}
+
+void GzipIndex::set_size(uint64_t size) {
+  size_ = size;
+  complete_ = true;
+}
+
+// ============================================================================
+// ===                             GZIPSOURCE                              ====
+// ============================================================================
+
+GzipSource::GzipSource(const std::string& filename,
+    std::shared_ptr<GzipIndex> index) : Source(),
+  filename_(filename), index_(index),
+  stream_(filename.c_str(), std::ios::in|std::ios::binary),
+  input_(INPUT_BUFFER_SIZE), output_(WINDOW_SIZE), in_position_(0),
+  out_position_(0), raw_(false), in_member_(false), end_(false)
+{
+  if (stream_.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  if (!index_) index_.reset(new GzipIndex());
+  std::memset(&strm_, 0, sizeof(strm_));
+  if (inflateInit2(&strm_, 31) != Z_OK)
+    throw std::runtime_error("Failed to initialise decompression of file '" + filename + "'.");
+  restart(0);
+}
+
+GzipSource::~GzipSource() {
+  inflateEnd(&strm_);
+}
+
+void GzipSource::seek(uint64_t position) {
+  // restart from a checkpoint when going back or when a checkpoint is closer
+  // than the current position
+  const GzipCheckpoint* checkpoint = index_->lookup(position);
+  if (position < out_position_ || (checkpoint && checkpoint->out > out_position_))
+    restart(checkpoint);
+  // decompress up to position
+  while (out_position_ < position && !end_) {
+    uint64_t n = position - out_position_;
+    if (n > output_.size()) n = output_.size();
+    inflate_block(&output_[0], n);
+  }
+}
+
+const char* GzipSource::next_block(unsigned int size, unsigned int& nread) {
+  if (output_.size() < size) output_.resize(size);
+  nread = 0;
+  while (nread < size && !end_)
+    nread += inflate_block(&output_[0] + nread, size - nread);
+  return &output_[0];
+}
+
+uint64_t GzipSource::size() const {
+  if (!index_->complete()) {
+    // decompress the remainder of the file starting from the last checkpoint
+    GzipSource source(filename_, index_);
+    source.seek(index_->last());
+    unsigned int nread = 0;
+    do {
+      source.next_block(1048576, nread);
+    } while (nread > 0);
+  }
+  return index_->size();
+}
+
+void GzipSource::restart(const GzipCheckpoint* checkpoint) {
+  stream_.clear();
+  strm_.next_in = Z_NULL;
+  strm_.avail_in = 0;
+  if (checkpoint) {
+    // continue decompressing the raw deflate data at the checkpoint
+    inflateReset2(&strm_, -15);
+    in_position_ = checkpoint->in - (checkpoint->bits ? 1 : 0);
+    stream_.seekg(static_cast<std::streamoff>(in_position_), std::ios::beg);
+    if (checkpoint->bits) {
+      int c = stream_.get();
+      if (c == EOF) throw std::runtime_error("Failed to read file '" + filename_ + "'.");
+      in_position_++;
+      inflatePrime(&strm_, checkpoint->bits, c >> (8 - checkpoint->bits));
+    }
+    if (!checkpoint->window.empty())
+      inflateSetDictionary(&strm_, &checkpoint->window[0], checkpoint->window.size());
+    out_position_ = checkpoint->out;
+    raw_ = true;
+  } else {
+    inflateReset2(&strm_, 31);
+    in_position_ = 0;
+    stream_.seekg(0, std::ios::beg);
+    out_position_ = 0;
+    raw_ = false;
+  }
+  in_member_ = true;
+  end_ = false;
+}
+
+bool GzipSource::fill_input() {
+  if (strm_.avail_in > 0) return true;
+  stream_.read(reinterpret_cast<char*>(&input_[0]), input_.size());
+  unsigned int nread = stream_.gcount();
+  in_position_ += nread;
+  strm_.next_in = &input_[0];
+  strm_.avail_in = nread;
+  return nread > 0;
+}
+
+unsigned int GzipSource::inflate_block(char* out, unsigned int size) {
+  if (!fill_input()) {
+    end_ = true;
+    if (in_member_)
+      throw std::runtime_error("Unexpected end of compressed file '" + filename_ + "'.");
+    return 0;
+  }
+  strm_.next_out = reinterpret_cast<Bytef*>(out);
+  strm_.avail_out = size;
+  // Z_BLOCK stops at the end of each deflate block; these are the points at
+  // which checkpoints can be created
+  int ret = inflate(&strm_, Z_BLOCK);
+  unsigned int n = size - strm_.avail_out;
+  out_position_ += n;
+  if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+    throw std::runtime_error("Failed to decompress file '" + filename_ + "'.");
+  if (ret == Z_STREAM_END) {
+    next_member();
+  } else if ((strm_.data_type & 128) && !(strm_.data_type & 64) &&
+      index_->needs_checkpoint(out_position_)) {
+    add_checkpoint();
+  }
+  return n;
+}
+
+void GzipSource::next_member() {
+  // when decompressing raw deflate data, the trailer of the member is not
+  // read by zlib
+  if (raw_) {
+    for (unsigned int i = 0; i < 8; ++i) {
+      if (!fill_input())
+        throw std::runtime_error("Unexpected end of compressed file '" + filename_ + "'.");
+      strm_.next_in++;
+      strm_.avail_in--;
+    }
+  }
+  in_member_ = false;
+  // check if another member follows; other trailing data is ignored
+  if (!fill_input() || strm_.next_in[0] != 0x1f) {
+    end_ = true;
+    index_->set_size(out_position_);
+    return;
+  }
+  inflateReset2(&strm_, 31);
+  raw_ = false;
+  in_member_ = true;
+}
+
+void GzipSource::add_checkpoint() {
+  GzipCheckpoint checkpoint;
+  checkpoint.out = out_position_;
+  checkpoint.in = in_position_ - strm_.avail_in;
+  checkpoint.bits = strm_.data_type & 7;
+  checkpoint.window.resize(WINDOW_SIZE);
+  uInt length = WINDOW_SIZE;
+  inflateGetDictionary(&strm_, &checkpoint.window[0], &length);
+  checkpoint.window.resize(length);
+  index_->add(checkpoint);
+}
+
+// ============================================================================
+// ============================================================================
+// ============================================================================
+
+bool is_gzip(const std::string& filename) {
+  std::ifstream stream(filename.c_str(), std::ios::in|std::ios::binary);
+  unsigned char magic[2];
+  stream.read(reinterpret_cast<char*>(magic), 2);
+  if (stream.gcount() != 2) return false;
+  return magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
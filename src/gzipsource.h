@@ -0,0 +1,114 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef gzipsource_h
+#define gzipsource_h
+
+#include "source.h"
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <zlib.h>
+
+// Point in a gzip file from which decompression can be restarted. out is the
+// position in the uncompressed data; in the position in the compressed file
+// of the first complete byte. When bits is not zero, the last bits bits of
+// the byte before in also belong to the data. window contains the 32K of
+// uncompressed data before out.
+struct GzipCheckpoint {
+  uint64_t out;
+  uint64_t in;
+  int bits;
+  std::vector<unsigned char> window;
+};
+
+// Checkpoints of a gzip file; every span bytes of uncompressed data a
+// checkpoint is stored. The checkpoints are filled while decompressing the
+// file and can be shared between sources reading the same file.
+class GzipIndex {
+  public:
+    GzipIndex(uint64_t span = 8*1024*1024);
+
+    // Last checkpoint at or before position; 0 when there is none.
+    const GzipCheckpoint* lookup(uint64_t position) const;
+    // Returns true when a checkpoint at out would be at least span bytes
+    // after the last checkpoint. Other checkpoints are ignored by add.
+    bool needs_checkpoint(uint64_t out) const;
+    void add(const GzipCheckpoint& checkpoint);
+    // Position of the last checkpoint; 0 when there are no checkpoints.
+    uint64_t last() const;
+
+    // Total size of the uncompressed data; only valid when complete.
+    void set_size(uint64_t size);
+    bool complete() const { return complete_;}
+    uint64_t size() const { return size_;}
+
+  private:
+    uint64_t span_;
+    std::vector<GzipCheckpoint> checkpoints_;
+    bool complete_;
+    uint64_t size_;
+};
+
+// Source that decompresses a gzip file while reading. Positions are positions
+// in the uncompressed data. Seeking restarts decompression from the nearest
+// checkpoint before the requested position (or from the start of the file)
+// after which data is decompressed up to the requested position. Files
+// consisting of multiple concatenated gzip members are supported.
+class GzipSource : public Source {
+  public:
+    GzipSource(const std::string& filename,
+      std::shared_ptr<GzipIndex> index = std::shared_ptr<GzipIndex>());
+    ~GzipSource();
+
+    void seek(uint64_t position);
+    const char* next_block(unsigned int size, unsigned int& nread);
+    // Determining the size requires decompressing the complete file (once).
+    uint64_t size() const;
+
+    const std::string& get_filename() const { return filename_;}
+    std::shared_ptr<GzipIndex> get_index() const { return index_;}
+
+  private:
+    void restart(const GzipCheckpoint* checkpoint);
+    unsigned int inflate_block(char* out, unsigned int size);
+    bool fill_input();
+    void next_member();
+    void add_checkpoint();
+
+    std::string filename_;
+    std::shared_ptr<GzipIndex> index_;
+    std::ifstream stream_;
+    z_stream strm_;
+    std::vector<unsigned char> input_;
+    std::vector<char> output_;
+    // position in the compressed file of the next byte read into input_
+    uint64_t in_position_;
+    // position in the uncompressed data of the next byte decompressed
+    uint64_t out_position_;
+    // raw deflate data (after a restart from a checkpoint) or gzip members
+    bool raw_;
+    bool in_member_;
+    bool end_;
+};
+
+// Returns true when the file starts with the gzip magic bytes.
+bool is_gzip(const std::string& filename);
+
+#endif
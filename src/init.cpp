@@ -7,21 +7,24 @@
 extern "C" {
 
   static const R_CallMethodDef r_calldef[] = {
-     CALLDEF(laf_open_csv, 7),
-     CALLDEF(laf_open_fwf, 6),
+     CALLDEF(laf_open_csv, 11),
+     CALLDEF(laf_open_fwf, 9),
      CALLDEF(laf_close, 1),
      CALLDEF(laf_reset, 1),
      CALLDEF(laf_goto_line, 2),
      CALLDEF(laf_nrow, 1),
      CALLDEF(laf_current_line, 1),
-     CALLDEF(laf_next_block, 4),
+     CALLDEF(laf_next_block, 5),
      CALLDEF(laf_read_lines, 4),
      CALLDEF(laf_levels, 2),
+     CALLDEF(laf_set_levels, 4),
+     CALLDEF(laf_share_levels, 5),
+     CALLDEF(laf_conversion_errors, 2),
      CALLDEF(colsum, 2),
      CALLDEF(colfreq, 2),
      CALLDEF(colrange, 2),
      CALLDEF(colnmissing, 2),
-     CALLDEF(nlines, 1),
+     CALLDEF(nlines, 2),
      CALLDEF(r_get_line, 2), 
      {NULL, NULL, 0}
   };
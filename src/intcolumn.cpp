@@ -28,19 +28,40 @@ IntColumn::~IntColumn() {
 }
 
 int IntColumn::get_value() const {
-  const char*  buffer = reader_->get_buffer(column_);
-  unsigned int length = reader_->get_length(column_);
-  try {
-    if (length == 0 || all_chars_equal(buffer, length, ' ')) return NA_INTEGER;
-    return strtoint(buffer, length);
-  } catch(const std::exception& e) {
-    if (ignore_failed_conversion_) return NA_INTEGER;
-    std::ostringstream message;
-    message << "Conversion to int failed; line=" << reader_->get_current_line()-1
-      << "; column=" << (column_ + 1L)
-      << "; string='" << std::string(buffer, length) << "'";
-    throw std::runtime_error(message.str());
+  return convert(reader_->get_buffer(column_), reader_->get_length(column_),
+    reader_->get_current_line()-1);
+}
+
+template<typename Fields>
+void IntColumn::assign_fields(unsigned int i, const Fields& fields, 
+    unsigned int n, uint64_t line) {
+  IntConverter converter(NA_INTEGER);
+  int* p = pv + i;
+  // the conversion loop stops at fields that can not be converted
+  for (unsigned int j = convert_fields(converter, fields, 0, n, p); j < n;
+      j = convert_fields(converter, fields, j + 1, n, p)) {
+    conversion_failed(fields.buffer(j), fields.length(j), line + j, "int");
+    p[j] = NA_INTEGER;
   }
 }
 
+void IntColumn::assign_stripe(unsigned int i, const char* stripe, 
+    unsigned int width, unsigned int n, uint64_t line) {
+  assign_fields(i, StripeFields(stripe, width), n, line);
+}
+
+void IntColumn::assign_spans(unsigned int i, const FieldSpan* spans, 
+    unsigned int n, uint64_t line) {
+  assign_fields(i, SpanFields(spans), n, line);
+}
+
+int IntColumn::convert(const char* buffer, unsigned int length, 
+    uint64_t line) const {
+  IntConverter converter(NA_INTEGER);
+  int value = NA_INTEGER;
+  if (converter(buffer, length, value)) return value;
+  conversion_failed(buffer, length, line, "int");
+  return NA_INTEGER;
+}
+
 
@@ -34,12 +34,32 @@ class IntColumn : public Column {
     int get_int() const {
       return get_value();
     }
+    double get_double(const char* buffer, unsigned int length, 
+        uint64_t line) const {
+      int value = convert(buffer, length, line);
+      if (value == NA_INTEGER) return NA_REAL;
+      return value;
+    }
+    int get_int(const char* buffer, unsigned int length, 
+        uint64_t line) const {
+      return convert(buffer, length, line);
+    }
 
     int get_value() const;
+    int convert(const char* buffer, unsigned int length, uint64_t line) const;
 
     virtual void assign() {
       (*pv) = get_value();
     }
+    virtual void assign_at(unsigned int i, const char* buffer, 
+        unsigned int length, uint64_t line) {
+      pv[i] = convert(buffer, length, line);
+    }
+    virtual void assign_stripe(unsigned int i, const char* stripe, 
+      unsigned int width, unsigned int n, uint64_t line);
+    virtual void assign_spans(unsigned int i, const FieldSpan* spans, 
+      unsigned int n, uint64_t line);
+    virtual bool thread_safe() const { return true;}
     virtual void init(Rcpp::List::Proxy proxy) {
       v = proxy;
       pv = v.begin();
@@ -49,6 +69,11 @@ class IntColumn : public Column {
     }
     
   private:
+    // Assign n fields using the conversion loop for the layout of fields.
+    template<typename Fields>
+    void assign_fields(unsigned int i, const Fields& fields, unsigned int n,
+      uint64_t line);
+
     Rcpp::IntegerVector v;
     int* pv;
 };
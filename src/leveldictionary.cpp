@@ -0,0 +1,85 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "leveldictionary.h"
+#include <cstring>
+
+namespace {
+  const size_t INITIAL_SLOTS = 16;
+
+  // Hash of the bytes of a level; processes eight bytes at a time.
+  uint64_t hash_level(const char* str, unsigned int length) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ length;
+    for (; length >= 8; str += 8, length -= 8) {
+      uint64_t x;
+      std::memcpy(&x, str, 8);
+      h = (h ^ x) * 0xBF58476D1CE4E5B9ULL;
+      h ^= h >> 31;
+    }
+    uint64_t x = 0;
+    std::memcpy(&x, str, length);
+    h = (h ^ x) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 29);
+  }
+}
+
+LevelDictionary::LevelDictionary() : offsets_(1, 0), 
+  slots_(INITIAL_SLOTS), mask_(INITIAL_SLOTS - 1)
+{
+}
+
+int LevelDictionary::find(const char* str, unsigned int length) const {
+  return slots_[lookup(str, length, hash_level(str, length))].code;
+}
+
+int LevelDictionary::add(const char* str, unsigned int length) {
+  uint64_t hash = hash_level(str, length);
+  size_t i = lookup(str, length, hash);
+  if (slots_[i].code) return slots_[i].code;
+  arena_.insert(arena_.end(), str, str + length);
+  offsets_.push_back(arena_.size());
+  slots_[i].hash = static_cast<uint32_t>(hash);
+  slots_[i].code = size();
+  // the table is kept at most half full
+  if (2*size() > slots_.size()) grow();
+  return size();
+}
+
+size_t LevelDictionary::lookup(const char* str, unsigned int length, 
+    uint64_t hash) const {
+  uint32_t h = static_cast<uint32_t>(hash);
+  for (size_t i = (hash >> 32) & mask_; ; i = (i + 1) & mask_) {
+    const Slot& slot = slots_[i];
+    if (slot.code == 0) return i;
+    if (slot.hash == h && offsets_[slot.code] - offsets_[slot.code-1] == length &&
+        std::memcmp(arena_.data() + offsets_[slot.code-1], str, length) == 0) 
+      return i;
+  }
+}
+
+void LevelDictionary::grow() {
+  std::vector<Slot>(2*slots_.size()).swap(slots_);
+  mask_ = slots_.size() - 1;
+  for (unsigned int code = 1; code <= size(); ++code) {
+    const char* level = arena_.data() + offsets_[code-1];
+    unsigned int length = offsets_[code] - offsets_[code-1];
+    uint64_t hash = hash_level(level, length);
+    size_t i = lookup(level, length, hash);
+    slots_[i].hash = static_cast<uint32_t>(hash);
+    slots_[i].code = code;
+  }
+}
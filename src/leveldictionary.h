@@ -0,0 +1,66 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef leveldictionary_h
+#define leveldictionary_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Levels of a categorical column. Levels are numbered 1, 2, ... in the order
+// in which they are added. The bytes of the levels are stored in one arena; 
+// levels are found using an open addressing hash table with linear probing.
+// Looking up a level that is already in the dictionary costs one hash and 
+// (usually) one comparison and does not allocate memory.
+class LevelDictionary {
+  public:
+    LevelDictionary();
+
+    // Returns the code of the level; 0 when the level is not found.
+    int find(const char* str, unsigned int length) const;
+    // Returns the code of the level; the level is added when it is not found.
+    int add(const char* str, unsigned int length);
+
+    unsigned int size() const { return offsets_.size() - 1;}
+    // Level with code code (1 <= code <= size()).
+    std::string get_level(int code) const {
+      return std::string(arena_.data() + offsets_[code-1], 
+        offsets_[code] - offsets_[code-1]);
+    }
+
+  private:
+    struct Slot {
+      uint32_t hash;
+      // code of the level; 0 when the slot is empty
+      int code;
+    };
+
+    // Returns the slot containing the level or the empty slot at which it 
+    // should be inserted.
+    size_t lookup(const char* str, unsigned int length, uint64_t hash) const;
+    void grow();
+
+    // level i consists of arena_[offsets_[i-1], offsets_[i])
+    std::vector<char> arena_;
+    std::vector<size_t> offsets_;
+    // number of slots is a power of two
+    std::vector<Slot> slots_;
+    size_t mask_;
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "lineindex.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+  const char INDEX_MAGIC[8] = {'L', 'A', 'F', 'I', 'D', 'X', '0', '4'};
+  const uint32_t INDEX_BYTE_ORDER = 0x01020304;
+
+  template<typename T>
+  void write_value(std::ofstream& output, T value) {
+    output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<typename T>
+  bool read_value(std::ifstream& input, T& value) {
+    input.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<size_t>(input.gcount()) == sizeof(T);
+  }
+
+  // Part of the file [begin, end) for which the positions of the lines are
+  // collected in LineIndex::build. As the number of lines before begin is not
+  // known yet, the positions of every stride-th line after begin are 
+  // collected.
+  struct Part {
+    const std::string* filename;
+    uint64_t begin;
+    uint64_t end;
+    unsigned int stride;
+    // results
+    std::vector<uint64_t> positions;
+    uint64_t n;
+    std::string error;
+  };
+
+  void collect_positions(Part* part) {
+    try {
+      std::ifstream input(part->filename->c_str(), std::ios::in|std::ios::binary);
+      input.seekg(static_cast<std::streamoff>(part->begin), std::ios::beg);
+      const unsigned int buffer_size = 1000000;
+      std::vector<char> buffer(buffer_size);
+      uint64_t position = part->begin;
+      uint64_t n = 0;
+      while (position < part->end && input) {
+        uint64_t size = std::min<uint64_t>(buffer_size, part->end - position);
+        input.read(&buffer[0], size);
+        unsigned int nread = input.gcount();
+        if (nread == 0) break;
+        const char* p = &buffer[0];
+        const char* end = p + nread;
+        while ((p = static_cast<const char*>(std::memchr(p, '\n', end - p)))) {
+          ++p;
+          ++n;
+          if ((n % part->stride) == 0)
+            part->positions.push_back(position + (p - &buffer[0]));
+        }
+        position += nread;
+      }
+      part->n = n;
+    } catch(const std::exception& e) {
+      part->error = e.what();
+    }
+  }
+}
+
+LineIndex::LineIndex(unsigned int stride) : stride_(stride),
+  complete_(false), nlines_(0) {
+  identity_.size = 0;
+  identity_.mtime = 0;
+}
+
+void LineIndex::add(uint64_t line, uint64_t position) {
+  if (complete_) return;
+  if ((line % stride_) != 0) return;
+  if ((line / stride_) != positions_.size()) return;
+  lines_.push_back(line);
+  positions_.push_back(position);
+}
+
+uint64_t LineIndex::lookup(uint64_t line, uint64_t& position) const {
+  if (positions_.empty()) return 0;
+  std::vector<uint64_t>::const_iterator p = 
+    std::upper_bound(lines_.begin(), lines_.end(), line);
+  if (p == lines_.begin()) return 0;
+  --p;
+  position = positions_[p - lines_.begin()];
+  return *p;
+}
+
+void LineIndex::build(const std::string& filename, uint64_t offset, 
+    unsigned int threads) {
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity)) 
+    throw std::runtime_error("Failed to open file '" + filename + "'.");
+  // the size of the file is only used to split the file into parts; the 
+  // last part extends to the end of the file
+  std::vector<uint64_t> bounds = split_range(offset, identity.size, threads);
+  bounds.back() = END_OF_FILE;
+  unsigned int nparts = bounds.size() - 1;
+  std::vector<Part> parts(nparts);
+  std::vector<std::thread> workers;
+  workers.reserve(nparts);
+  for (unsigned int i = 0; i < nparts; ++i) {
+    parts[i].filename = &filename;
+    parts[i].begin = bounds[i];
+    parts[i].end = bounds[i+1];
+    parts[i].stride = stride_;
+  }
+  for (unsigned int i = 1; i < nparts; ++i) {
+    try {
+      workers.push_back(std::thread(collect_positions, &parts[i]));
+    } catch(const std::exception&) {
+      collect_positions(&parts[i]);
+    }
+  }
+  collect_positions(&parts[0]);
+  for (std::vector<std::thread>::iterator p = workers.begin(); p != workers.end(); ++p)
+    p->join();
+  // the line numbers of the positions of a part follow from the number of 
+  // lines in the preceding parts
+  std::vector<uint64_t> lines;
+  std::vector<uint64_t> positions;
+  lines.push_back(0);
+  positions.push_back(offset);
+  uint64_t n = 0;
+  for (std::vector<Part>::const_iterator p = parts.begin(); p != parts.end(); ++p) {
+    if (!p->error.empty()) throw std::runtime_error(p->error);
+    for (unsigned int i = 0; i < p->positions.size(); ++i) 
+      lines.push_back(n + static_cast<uint64_t>(i + 1)*stride_);
+    positions.insert(positions.end(), p->positions.begin(), p->positions.end());
+    n += p->n;
+  }
+  lines_.swap(lines);
+  positions_.swap(positions);
+  nlines_ = n;
+  complete_ = true;
+  identity_ = identity;
+}
+
+void LineIndex::build(Source& source, const std::string& filename,
+    uint64_t offset) {
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity)) 
+    throw std::runtime_error("Failed to open file '" + filename + "'.");
+  source.set_access(Source::SEQUENTIAL);
+  source.seek(offset);
+  std::vector<uint64_t> lines;
+  std::vector<uint64_t> positions;
+  lines.push_back(0);
+  positions.push_back(offset);
+  uint64_t position = offset;
+  uint64_t n = 0;
+  unsigned int nread = 0;
+  while (true) {
+    const char* buffer = source.next_block(1000000, nread);
+    if (nread == 0) break;
+    const char* p = buffer;
+    const char* end = p + nread;
+    while ((p = static_cast<const char*>(std::memchr(p, '\n', end - p)))) {
+      ++p;
+      ++n;
+      if ((n % stride_) == 0) {
+        lines.push_back(n);
+        positions.push_back(position + (p - buffer));
+      }
+    }
+    position += nread;
+  }
+  lines_.swap(lines);
+  positions_.swap(positions);
+  nlines_ = n;
+  complete_ = true;
+  identity_ = identity;
+}
+
+bool LineIndex::matches(const std::string& filename) const {
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity)) return false;
+  return identity == identity_;
+}
+
+bool LineIndex::read(const std::string& index_filename,
+    const std::string& filename, uint64_t offset) {
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity)) return false;
+  std::ifstream input(index_filename.c_str(), std::ios::in|std::ios::binary);
+  if (!input) return false;
+  char magic[8];
+  input.read(magic, 8);
+  if (input.gcount() != 8 || std::memcmp(magic, INDEX_MAGIC, 8) != 0) return false;
+  uint32_t byte_order, stride, complete;
+  uint64_t size, stored_offset, nlines, npositions;
+  int64_t mtime;
+  if (!read_value(input, byte_order) || byte_order != INDEX_BYTE_ORDER) return false;
+  if (!read_value(input, size) || !read_value(input, mtime)) return false;
+  if (size != identity.size || mtime != identity.mtime) return false;
+  if (!read_value(input, stored_offset) || stored_offset != offset) return false;
+  if (!read_value(input, stride) || stride != stride_) return false;
+  if (!read_value(input, complete) || !read_value(input, nlines)) return false;
+  if (!read_value(input, npositions)) return false;
+  std::vector<uint64_t> lines(npositions);
+  std::vector<uint64_t> positions(npositions);
+  if (npositions > 0) {
+    input.read(reinterpret_cast<char*>(&lines[0]), npositions*sizeof(uint64_t));
+    if (static_cast<uint64_t>(input.gcount()) != npositions*sizeof(uint64_t))
+      return false;
+    input.read(reinterpret_cast<char*>(&positions[0]), npositions*sizeof(uint64_t));
+    if (static_cast<uint64_t>(input.gcount()) != npositions*sizeof(uint64_t))
+      return false;
+  }
+  lines_.swap(lines);
+  positions_.swap(positions);
+  complete_ = complete != 0;
+  nlines_ = nlines;
+  identity_ = identity;
+  return true;
+}
+
+bool LineIndex::write(const std::string& index_filename,
+    const std::string& filename, uint64_t offset) const {
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity)) return false;
+  std::ofstream output(index_filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+  if (!output) return false;
+  output.write(INDEX_MAGIC, 8);
+  write_value<uint32_t>(output, INDEX_BYTE_ORDER);
+  write_value<uint64_t>(output, identity.size);
+  write_value<int64_t>(output, identity.mtime);
+  write_value<uint64_t>(output, offset);
+  write_value<uint32_t>(output, stride_);
+  write_value<uint32_t>(output, complete_ ? 1 : 0);
+  write_value<uint64_t>(output, nlines_);
+  write_value<uint64_t>(output, positions_.size());
+  if (!positions_.empty()) {
+    output.write(reinterpret_cast<const char*>(&lines_[0]),
+      lines_.size()*sizeof(uint64_t));
+    output.write(reinterpret_cast<const char*>(&positions_[0]),
+      positions_.size()*sizeof(uint64_t));
+  }
+  return output.good();
+}
+
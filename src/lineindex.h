@@ -0,0 +1,85 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef lineindex_h
+#define lineindex_h
+
+#include "file.h"
+#include "source.h"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Sparse index of the byte positions at which lines start. The position of
+// every stride-th line is stored; when the index is built in parts (see 
+// build), the lines are stride apart within each part. The index can be 
+// filled while the file is read sequentially (add) or built in one pass over
+// the file (build). The
+// index can be stored in a file next to the data file; it is only read back
+// when the size and modification time of the data file still match.
+class LineIndex {
+  public:
+    LineIndex(unsigned int stride = 1024);
+
+    // Record the position at which line starts. Lines that are not a multiple
+    // of the stride, or that are not directly after the last indexed line, are
+    // ignored.
+    void add(uint64_t line, uint64_t position);
+    // Look up the last indexed line at or before line. Returns that line and
+    // stores its position in position. Returns 0 when the index is empty.
+    uint64_t lookup(uint64_t line, uint64_t& position) const;
+
+    // Build the complete index by counting the line endings in the file
+    // starting at offset. When threads > 1, the file is split into parts 
+    // that are read in parallel; each part collects the positions of every 
+    // stride-th line in the part, which are numbered afterwards using the 
+    // number of lines in the preceding parts.
+    void build(const std::string& filename, uint64_t offset, 
+      unsigned int threads = 1);
+    // Build the complete index reading sequentially from source. Used for
+    // sources that can not be read in parts, such as compressed files. The
+    // index belongs to filename.
+    void build(Source& source, const std::string& filename, uint64_t offset);
+
+    bool complete() const { return complete_;}
+    // Returns true when the index was built for, or read for, the current 
+    // version (size and modification time) of filename.
+    bool matches(const std::string& filename) const;
+    // Number of line endings in the file; only valid when complete.
+    uint64_t nlines() const { return nlines_;}
+    unsigned int size() const { return positions_.size();}
+
+    // Read the index from, or write the index to, index_filename. The index
+    // belongs to filename; offset is the position of the first line. read
+    // returns false when the index file does not exist, is invalid or does
+    // not match the data file.
+    bool read(const std::string& index_filename, const std::string& filename,
+      uint64_t offset);
+    bool write(const std::string& index_filename, const std::string& filename,
+      uint64_t offset) const;
+
+  private:
+    unsigned int stride_;
+    // lines_[i] starts at positions_[i]
+    std::vector<uint64_t> lines_;
+    std::vector<uint64_t> positions_;
+    bool complete_;
+    uint64_t nlines_;
+    FileIdentity identity_;
+};
+
+#endif
@@ -0,0 +1,32 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef powersoffive_h
+#define powersoffive_h
+
+#include <stdint.h>
+
+const int SMALLEST_POWER_OF_FIVE = -342;
+const int LARGEST_POWER_OF_FIVE = 308;
+
+// 128 bit approximations of the powers of five 5^q for q in 
+// [SMALLEST_POWER_OF_FIVE, LARGEST_POWER_OF_FIVE]. The approximations are 
+// normalised such that the most significant bit is set and stored as pairs 
+// (high 64 bits, low 64 bits). Used by strtodouble.
+extern const uint64_t POWERS_OF_FIVE_128[];
+
+#endif
@@ -16,9 +16,28 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "reader.h" 
+#include "filter.h"
 
 Reader::Reader() : decimal_seperator_('.'), trim_(false), 
-  ignore_failed_conversion_(false) {
+  ignore_failed_conversion_(false), threads_(1) {
+}
+
+void Reader::set_used_columns(const std::vector<unsigned int>&) {
+}
+
+unsigned int Reader::read_block(const std::vector<Column*>& columns, 
+    unsigned int nlines, const Filter* filter) {
+  unsigned int nread = 0;
+  while (nread < nlines && next_line()) {
+    if (filter && !filter->pass(*this)) continue;
+    for (std::vector<Column*>::const_iterator p = columns.begin(); 
+        p != columns.end(); ++p) {
+      (*p)->assign();
+      (*p)->next();
+    }
+    ++nread;
+  }
+  return nread;
 }
 
 Reader::~Reader() {
@@ -85,3 +104,11 @@ void Reader::set_ignore_failed_conversion(bool ignore) {
 bool Reader::get_ignore_failed_conversion() const {
   return ignore_failed_conversion_;
 }
+
+void Reader::set_threads(unsigned int threads) {
+  threads_ = threads > 0 ? threads : 1;
+}
+
+unsigned int Reader::get_threads() const {
+  return threads_;
+}
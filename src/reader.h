@@ -22,24 +22,39 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 #include "doublecolumn.h"
 #include "stringcolumn.h"
 #include "factorcolumn.h"
+#include "conversionlog.h"
 #include <vector>
 
+class Filter;
+
 class Reader {
   public:
     Reader();
     virtual ~Reader();
 
-    virtual unsigned int nlines() const = 0;
+    virtual uint64_t nlines() const = 0;
 
     virtual void reset() = 0;
     virtual bool next_line() = 0;
-    virtual bool goto_line(unsigned int line) = 0;
+    virtual bool goto_line(uint64_t line) = 0;
 
-    virtual unsigned int get_current_line() const = 0;
+    virtual uint64_t get_current_line() const = 0;
 
     virtual const char* get_buffer(unsigned int i) const = 0;
     virtual unsigned int get_length(unsigned int i) const = 0;
 
+    // Only the given columns are used by the following calls of next_line 
+    // and goto_line; readers can skip the other fields. An empty vector 
+    // selects all columns. The default implementation ignores this.
+    virtual void set_used_columns(const std::vector<unsigned int>& columns);
+
+    // Read at most nlines lines and assign them to columns. The columns
+    // should have been initialised. When filter is given, only lines that
+    // pass the filter are assigned and counted. Returns the number of lines 
+    // assigned. 
+    virtual unsigned int read_block(const std::vector<Column*>& columns,
+      unsigned int nlines, const Filter* filter = 0);
+
     const DoubleColumn* add_double_column();
     const IntColumn* add_int_column();
     const StringColumn* add_string_column();
@@ -56,12 +71,22 @@ class Reader {
 
     void set_ignore_failed_conversion(bool ignore);
     bool get_ignore_failed_conversion() const; 
+    // Fields that could not be converted when failed conversions are ignored.
+    // Columns add to the log while converting (also from const methods).
+    ConversionLog& get_conversion_log() const { return conversion_log_;}
+
+    // Number of threads used by read_block. Readers that do not support
+    // reading in parallel ignore this.
+    void set_threads(unsigned int threads);
+    unsigned int get_threads() const;
     
   private:
     std::vector<Column*> columns_;
     char decimal_seperator_;
     bool trim_;
     bool ignore_failed_conversion_;
+    unsigned int threads_;
+    mutable ConversionLog conversion_log_;
 };
 
 #endif
@@ -0,0 +1,84 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "scanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define LAF_SCAN_X86
+#include <immintrin.h>
+#endif
+
+const char* scan_scalar(const char* begin, const char* end, char c1, char c2,
+    char c3, char c4) {
+  for (; begin < end; ++begin) {
+    char c = *begin;
+    if (c == c1 || c == c2 || c == c3 || c == c4) break;
+  }
+  return begin;
+}
+
+#ifdef LAF_SCAN_X86
+
+static const char* scan_sse2(const char* begin, const char* end, char c1,
+    char c2, char c3, char c4) {
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  const __m128i v3 = _mm_set1_epi8(c3);
+  const __m128i v4 = _mm_set1_epi8(c4);
+  for (; begin + 16 <= end; begin += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+    __m128i m = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(x, v1), _mm_cmpeq_epi8(x, v2)),
+      _mm_or_si128(_mm_cmpeq_epi8(x, v3), _mm_cmpeq_epi8(x, v4)));
+    unsigned int mask = _mm_movemask_epi8(m);
+    if (mask) return begin + __builtin_ctz(mask);
+  }
+  return scan_scalar(begin, end, c1, c2, c3, c4);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_avx2(const char* begin, const char* end, char c1,
+    char c2, char c3, char c4) {
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  const __m256i v3 = _mm256_set1_epi8(c3);
+  const __m256i v4 = _mm256_set1_epi8(c4);
+  for (; begin + 32 <= end; begin += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+    __m256i m = _mm256_or_si256(
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, v1), _mm256_cmpeq_epi8(x, v2)),
+      _mm256_or_si256(_mm256_cmpeq_epi8(x, v3), _mm256_cmpeq_epi8(x, v4)));
+    unsigned int mask = _mm256_movemask_epi8(m);
+    if (mask) return begin + __builtin_ctz(mask);
+  }
+  return scan_sse2(begin, end, c1, c2, c3, c4);
+}
+
+ScanFunction get_scanner() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return scan_avx2;
+  return scan_sse2;
+}
+
+#else
+
+ScanFunction get_scanner() {
+  return scan_scalar;
+}
+
+#endif
+
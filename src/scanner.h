@@ -0,0 +1,35 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef scanner_h
+#define scanner_h
+
+// Returns a pointer to the first character in [begin, end) that is equal to
+// one of c1, c2, c3 or c4. When none of the characters is found end is
+// returned.
+typedef const char* (*ScanFunction)(const char* begin, const char* end,
+  char c1, char c2, char c3, char c4);
+
+// Returns the fastest scan function supported by the CPU. On x86 AVX2 (32
+// bytes at a time) or SSE2 (16 bytes at a time) are used when available;
+// otherwise a scalar loop is used.
+ScanFunction get_scanner();
+
+const char* scan_scalar(const char* begin, const char* end, char c1, char c2,
+  char c3, char c4);
+
+#endif
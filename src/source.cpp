@@ -0,0 +1,446 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "source.h"
+#include "gzipsource.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  // Ranges separated by less than this number of bytes are read using one 
+  // call; the bytes between the ranges are read and discarded.
+  const unsigned int MAX_RANGE_GAP = 4096;
+  // Maximum number of bytes read by one call in read_ranges
+  const unsigned int MAX_SPAN_SIZE = 1048576;
+}
+
+Source::Source() : access_(SEQUENTIAL) {
+}
+
+Source::~Source() {
+}
+
+void Source::set_access(Access access) {
+  access_ = access;
+}
+
+Source::Access Source::get_access() const {
+  return access_;
+}
+
+bool Source::read_ranges(const std::vector<ByteRange>&) {
+  return false;
+}
+
+// ============================================================================
+// ===                            STREAMSOURCE                             ====
+// ============================================================================
+
+StreamSource::StreamSource(const std::string& filename) : Source(),
+  filename_(filename), stream_(filename.c_str(), std::ios::in|std::ios::binary), 
+  buffer_(0), buffer_size_(0), position_(0), in_sync_(true), fd_(-1)
+{
+  if (stream_.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+}
+
+StreamSource::~StreamSource() {
+  if (stream_.is_open()) stream_.close();
+#ifndef _WIN32
+  if (fd_ >= 0) close(fd_);
+#endif
+  delete [] buffer_;
+}
+
+void StreamSource::seek(uint64_t position) {
+  // the stream is positioned when the next block is read; random reads do
+  // not need the stream
+  position_ = position;
+  in_sync_ = false;
+}
+
+const char* StreamSource::next_block(unsigned int size, unsigned int& nread) {
+  if (size > buffer_size_) {
+    delete [] buffer_;
+    buffer_ = new char[size];
+    buffer_size_ = size;
+  }
+  nread = 0;
+  if (access_ == RANDOM && read_at(size, nread)) {
+    position_ += nread;
+    in_sync_ = false;
+    return buffer_;
+  }
+  if (!in_sync_) {
+    stream_.clear();
+    stream_.seekg(static_cast<std::streamoff>(position_), std::ios::beg);
+    in_sync_ = true;
+  }
+  if (stream_.good()) {
+    stream_.read(buffer_, size);
+    nread = stream_.gcount();
+  }
+  position_ += nread;
+  return buffer_;
+}
+
+#ifndef _WIN32
+
+bool StreamSource::read_at(unsigned int size, unsigned int& nread) {
+  if (fd_ < 0) {
+    fd_ = open(filename_.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+  }
+  nread = 0;
+  while (nread < size) {
+    ssize_t n = pread(fd_, buffer_ + nread, size - nread, 
+      static_cast<off_t>(position_ + nread));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw std::runtime_error("Failed to read file '" + filename_ + "'.");
+    if (n == 0) break;
+    nread += n;
+  }
+  return true;
+}
+
+bool StreamSource::read_ranges(const std::vector<ByteRange>& ranges) {
+  if (fd_ < 0) {
+    fd_ = open(filename_.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+  }
+  std::vector<ByteRange>::const_iterator p = ranges.begin();
+  while (p != ranges.end()) {
+    // collect the ranges that can be read with one call 
+    std::vector<ByteRange>::const_iterator first = p;
+    uint64_t position = p->position;
+    uint64_t end = position;
+    for (; p != ranges.end(); ++p) {
+      if (p->position < end) 
+        throw std::runtime_error("Ranges of file '" + filename_ + "' overlap.");
+      if (p->position - end > MAX_RANGE_GAP) break;
+      if (p != first && p->position + p->size - position > MAX_SPAN_SIZE) break;
+      end = p->position + p->size;
+    }
+    size_t size = end - position;
+    if (span_.size() < size) span_.resize(size);
+    // read; pread can return less bytes than requested
+    size_t nread = 0;
+    while (nread < size) {
+      ssize_t n = pread(fd_, &span_[nread], size - nread, 
+        static_cast<off_t>(position + nread));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) throw std::runtime_error("Failed to read file '" + filename_ + "'.");
+      nread += n;
+    }
+    for (; first != p; ++first) 
+      std::memcpy(first->dest, &span_[first->position - position], first->size);
+  }
+  return true;
+}
+
+unsigned int StreamSource::range_gap() const {
+  return MAX_RANGE_GAP;
+}
+
+#else
+
+bool StreamSource::read_at(unsigned int, unsigned int&) {
+  return false;
+}
+
+bool StreamSource::read_ranges(const std::vector<ByteRange>&) {
+  return false;
+}
+
+unsigned int StreamSource::range_gap() const {
+  return 0;
+}
+
+#endif
+
+uint64_t StreamSource::size() const {
+  stream_.clear();
+  stream_.seekg(0, std::ios::end);
+  uint64_t size = static_cast<uint64_t>(stream_.tellg());
+  // the stream is positioned again before the next block is read
+  in_sync_ = false;
+  return size;
+}
+
+// ============================================================================
+// ===                             MMAPSOURCE                              ====
+// ============================================================================
+
+#ifndef _WIN32
+
+MMapSource::MMapSource(const std::string& filename) : Source(),
+  data_(0), size_(0), position_(0)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+      static_cast<uint64_t>(st.st_size) != static_cast<size_t>(st.st_size)) {
+    close(fd);
+    throw std::runtime_error("Failed to map file '" + filename + "'.");
+  }
+  size_ = st.st_size;
+  void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping remains valid after the file descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED) throw std::runtime_error("Failed to map file '" + filename + "'.");
+  data_ = static_cast<char*>(data);
+  madvise(data_, size_, MADV_SEQUENTIAL);
+}
+
+MMapSource::~MMapSource() {
+  if (data_) munmap(data_, size_);
+}
+
+void MMapSource::set_access(Access access) {
+  if (access == access_) return;
+  madvise(data_, size_, access == RANDOM ? MADV_RANDOM : MADV_SEQUENTIAL);
+  Source::set_access(access);
+}
+
+bool MMapSource::read_ranges(const std::vector<ByteRange>& ranges) {
+  for (std::vector<ByteRange>::const_iterator p = ranges.begin(); 
+      p != ranges.end(); ++p) {
+    if (p->position + p->size > size_) 
+      throw std::runtime_error("Range outside of file.");
+    std::memcpy(p->dest, data_ + p->position, p->size);
+  }
+  return true;
+}
+
+unsigned int MMapSource::range_gap() const {
+  long page_size = sysconf(_SC_PAGESIZE);
+  return page_size > 0 ? static_cast<unsigned int>(page_size) : 4096;
+}
+
+#else
+
+MMapSource::MMapSource(const std::string&) : Source(),
+  data_(0), size_(0), position_(0)
+{
+  throw std::runtime_error("Memory mapping of files is not supported on this platform.");
+}
+
+MMapSource::~MMapSource() {
+}
+
+void MMapSource::set_access(Access access) {
+  Source::set_access(access);
+}
+
+bool MMapSource::read_ranges(const std::vector<ByteRange>&) {
+  return false;
+}
+
+unsigned int MMapSource::range_gap() const {
+  return 0;
+}
+
+#endif
+
+void MMapSource::seek(uint64_t position) {
+  position_ = position < size_ ? position : size_;
+}
+
+const char* MMapSource::next_block(unsigned int size, unsigned int& nread) {
+  uint64_t remaining = size_ - position_;
+  nread = remaining < size ? static_cast<unsigned int>(remaining) : size;
+  const char* block = data_ + position_;
+  position_ += nread;
+  return block;
+}
+
+uint64_t MMapSource::size() const {
+  return size_;
+}
+
+// ============================================================================
+// ===                           PREFETCHSOURCE                            ====
+// ============================================================================
+
+PrefetchSource::PrefetchSource(const std::string& filename, 
+    unsigned int read_ahead) : Source(),
+  stream_(filename.c_str(), std::ios::in|std::ios::binary), size_(0), 
+  position_(0), buffers_(read_ahead + 1), nread_(read_ahead + 1, 0), 
+  current_(-1), block_size_(0), running_(false), stop_(false), done_(false)
+{
+  if (stream_.fail()) throw std::runtime_error("Failed to open file '" + filename + "'.");
+  stream_.seekg(0, std::ios::end);
+  size_ = static_cast<uint64_t>(stream_.tellg());
+  stream_.seekg(0, std::ios::beg);
+}
+
+PrefetchSource::~PrefetchSource() {
+  stop();
+}
+
+void PrefetchSource::seek(uint64_t position) {
+  stop();
+  position_ = position;
+}
+
+void PrefetchSource::set_access(Access access) {
+  if (access == RANDOM) stop();
+  Source::set_access(access);
+}
+
+const char* PrefetchSource::next_block(unsigned int size, unsigned int& nread) {
+  if (running_ && size != block_size_) stop();
+  if (!running_ && access_ == SEQUENTIAL) start(size);
+  if (!running_) {
+    // read directly
+    if (buffers_[0].size() < size) buffers_[0].resize(size);
+    stream_.clear();
+    stream_.seekg(static_cast<std::streamoff>(position_), std::ios::beg);
+    stream_.read(&buffers_[0][0], size);
+    nread = stream_.gcount();
+    position_ += nread;
+    return &buffers_[0][0];
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  // the previous block is no longer used by the reader
+  if (current_ >= 0) {
+    free_.push_back(current_);
+    current_ = -1;
+    free_condition_.notify_one();
+  }
+  while (filled_.empty() && !done_) filled_condition_.wait(lock);
+  if (filled_.empty()) {
+    nread = 0;
+    return &buffers_[0][0];
+  }
+  current_ = filled_.front();
+  filled_.pop_front();
+  nread = nread_[current_];
+  position_ += nread;
+  return &buffers_[current_][0];
+}
+
+uint64_t PrefetchSource::size() const {
+  return size_;
+}
+
+void PrefetchSource::start(unsigned int block_size) {
+  block_size_ = block_size;
+  for (unsigned int i = 0; i < buffers_.size(); ++i) {
+    if (buffers_[i].size() < block_size) buffers_[i].resize(block_size);
+  }
+  filled_.clear();
+  free_.clear();
+  for (unsigned int i = 0; i < buffers_.size(); ++i) free_.push_back(i);
+  current_ = -1;
+  stop_ = false;
+  done_ = false;
+  stream_.clear();
+  stream_.seekg(static_cast<std::streamoff>(position_), std::ios::beg);
+  try {
+    thread_ = std::thread(&PrefetchSource::run, this);
+    running_ = true;
+  } catch(const std::exception&) {
+    // no thread available; blocks are read directly
+  }
+}
+
+void PrefetchSource::stop() {
+  if (!running_) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  free_condition_.notify_one();
+  thread_.join();
+  running_ = false;
+  current_ = -1;
+}
+
+void PrefetchSource::run() {
+  while (true) {
+    unsigned int buffer;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (free_.empty() && !stop_) free_condition_.wait(lock);
+      if (stop_) return;
+      buffer = free_.front();
+      free_.pop_front();
+    }
+    stream_.read(&buffers_[buffer][0], block_size_);
+    unsigned int nread = stream_.gcount();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      nread_[buffer] = nread;
+      filled_.push_back(buffer);
+      if (nread < block_size_) done_ = true;
+    }
+    filled_condition_.notify_one();
+    if (nread < block_size_) return;
+  }
+}
+
+// ============================================================================
+// ============================================================================
+// ============================================================================
+
+SourceStream::SourceStream(Source* source, uint64_t position) : 
+  source_(source), block_(0), nread_(0), pointer_(0)
+{
+  source_->seek(position);
+}
+
+int SourceStream::get() {
+  if (pointer_ >= nread_) {
+    block_ = source_->next_block(4096, nread_);
+    pointer_ = 0;
+    if (nread_ == 0) return EOF;
+  }
+  return static_cast<unsigned char>(block_[pointer_++]);
+}
+
+bool has_bom(Source* source) {
+  SourceStream stream(source);
+  if (stream.get() != 239) return false;
+  if (stream.get() != 187) return false;
+  if (stream.get() != 191) return false;
+  return true;
+}
+
+Source* open_source(const std::string& filename, bool use_mmap, 
+    unsigned int read_ahead) {
+  if (is_gzip(filename)) return new GzipSource(filename);
+  if (use_mmap) {
+    try {
+      return new MMapSource(filename);
+    } catch(const std::exception& e) {
+      // fall back to reading using a stream
+    }
+  }
+  if (read_ahead > 0) return new PrefetchSource(filename, read_ahead);
+  return new StreamSource(filename);
+}
+
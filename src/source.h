@@ -0,0 +1,213 @@
+/*
+Copyright 2024 Jan van der Laan
+
+This file is part of LaF.
+
+LaF is free software: you can redistribute it and/or modify it under the terms
+of the GNU General Public License as published by the Free Software Foundation,
+either version 3 of the License, or (at your option) any later version.
+
+LaF is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+LaF.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef source_h
+#define source_h
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// Range of bytes in a file that is copied to dest by Source::read_ranges.
+struct ByteRange {
+  uint64_t position;
+  unsigned int size;
+  char* dest;
+};
+
+// Source of the bytes of a file. The readers request blocks of bytes from a
+// source; the source returns a pointer to memory it owns. This pointer remains
+// valid until the next call to next_block or seek.
+class Source {
+  public:
+    enum Access { SEQUENTIAL, RANDOM };
+
+    Source();
+    virtual ~Source();
+
+    // Set the position from which the next block will be read.
+    virtual void seek(uint64_t position) = 0;
+    // Return the next block of at most size bytes. The number of bytes in the
+    // block is stored in nread; this is only smaller than size at the end of
+    // the file.
+    virtual const char* next_block(unsigned int size, unsigned int& nread) = 0;
+    // Total number of bytes in the file.
+    virtual uint64_t size() const = 0;
+    // Returns true when the blocks returned by next_block remain valid until
+    // the source is destroyed (instead of until the next call to next_block).
+    virtual bool blocks_persist() const { return false;}
+
+    // Copy the given ranges of the file; the ranges should be sorted by 
+    // position, should not overlap and should lie within the file. Only the
+    // requested bytes are read (as far as possible); used to read a small part
+    // of each of the lines of a file. Does not change the position of the 
+    // source. Returns false when not supported by the source; in that case 
+    // nothing is read. Calling read_ranges without ranges can be used to check
+    // whether it is supported.
+    virtual bool read_ranges(const std::vector<ByteRange>& ranges);
+    // Ranges that are separated by at most this number of bytes are read 
+    // from the file together by read_ranges; reading only the ranges saves
+    // reading bytes only when these are further apart. 
+    virtual unsigned int range_gap() const { return 0;}
+
+    // Hint about the way the file will be accessed.
+    virtual void set_access(Access access);
+    Access get_access() const;
+
+  protected:
+    Access access_;
+};
+
+// Reads the file using a stream. For random access the file is read using
+// pread (when available); this reads only the requested bytes instead of 
+// filling the buffer of the stream.
+class StreamSource : public Source {
+  public:
+    StreamSource(const std::string& filename);
+    ~StreamSource();
+
+    void seek(uint64_t position);
+    const char* next_block(unsigned int size, unsigned int& nread);
+    uint64_t size() const;
+
+    // Ranges that are close together are read using one call to pread into
+    // a scratch buffer from which the ranges are copied.
+    bool read_ranges(const std::vector<ByteRange>& ranges);
+    unsigned int range_gap() const;
+
+  private:
+    // Reads directly at position_ without going through the stream (and its
+    // buffer); used for random access. Returns false when not supported.
+    bool read_at(unsigned int size, unsigned int& nread);
+
+    std::string filename_;
+    mutable std::ifstream stream_;
+    char* buffer_;
+    unsigned int buffer_size_;
+    // position of the next block; the stream is only positioned there when
+    // in_sync_ is true
+    uint64_t position_;
+    mutable bool in_sync_;
+    // file descriptor used for random access; opened on first use
+    int fd_;
+    // receives the ranges (and the bytes between them) in read_ranges
+    std::vector<char> span_;
+};
+
+// Maps the complete file into memory. Blocks are returned as pointers into
+// the mapped region; no data is copied. Only available on POSIX systems; on
+// other systems the constructor throws.
+class MMapSource : public Source {
+  public:
+    MMapSource(const std::string& filename);
+    ~MMapSource();
+
+    void seek(uint64_t position);
+    const char* next_block(unsigned int size, unsigned int& nread);
+    uint64_t size() const;
+    bool blocks_persist() const { return true;}
+
+    // Copies the ranges from the mapped file. With random access (see 
+    // set_access) only the pages containing the ranges are read by the system.
+    bool read_ranges(const std::vector<ByteRange>& ranges);
+    // The system reads complete pages.
+    unsigned int range_gap() const;
+
+    void set_access(Access access);
+
+  private:
+    char* data_;
+    uint64_t size_;
+    uint64_t position_;
+};
+
+// Reads the file using a stream in a background thread. While the reader
+// parses a block, the thread reads the next blocks into a ring of
+// read_ahead + 1 buffers. The thread is started on the first call to 
+// next_block after a seek. With random access blocks are read directly.
+class PrefetchSource : public Source {
+  public:
+    PrefetchSource(const std::string& filename, unsigned int read_ahead = 1);
+    ~PrefetchSource();
+
+    void seek(uint64_t position);
+    const char* next_block(unsigned int size, unsigned int& nread);
+    uint64_t size() const;
+
+    void set_access(Access access);
+
+  private:
+    void start(unsigned int block_size);
+    void stop();
+    void run();
+
+    std::ifstream stream_;
+    uint64_t size_;
+    // position of the next block returned by next_block
+    uint64_t position_;
+    // buffers; the buffer returned by the last call to next_block is 
+    // current_; filled_ contains the buffers read ahead in the order in which
+    // they were read
+    std::vector< std::vector<char> > buffers_;
+    std::vector<unsigned int> nread_;
+    std::deque<unsigned int> filled_;
+    std::deque<unsigned int> free_;
+    int current_;
+    unsigned int block_size_;
+    // thread
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable filled_condition_;
+    std::condition_variable free_condition_;
+    bool running_;
+    bool stop_;
+    bool done_;
+};
+
+// Reads a source one byte at a time; used to inspect the first lines of a
+// file. 
+class SourceStream {
+  public:
+    SourceStream(Source* source, uint64_t position = 0);
+
+    // Returns the next byte or EOF at the end of the file.
+    int get();
+
+  private:
+    Source* source_;
+    const char* block_;
+    unsigned int nread_;
+    unsigned int pointer_;
+};
+
+// Returns true when the data in the source starts with an UTF-8 byte order
+// mark.
+bool has_bom(Source* source);
+
+// Open a source for the file. Gzip compressed files are decompressed while
+// reading (see GzipSource). Otherwise, when use_mmap is true, the file is 
+// mapped into memory; when that fails a stream is used. When read_ahead > 0,
+// the stream is read in a background thread (see PrefetchSource). 
+Source* open_source(const std::string& filename, bool use_mmap, 
+  unsigned int read_ahead = 0);
+
+#endif
@@ -17,6 +17,8 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include "LaF.h"
+#include <algorithm>
+#include <thread>
 
 //TEST
 bool isna(double v) {
@@ -29,6 +31,86 @@ bool isna(int v) {
 // =======================================================================================
 // Iterator template.
 
+namespace {
+  // Number of records of fixed width files processed at once when using 
+  // multiple threads. Blocks smaller than MIN_LINES_PER_THREAD lines per 
+  // thread are processed using fewer threads.
+  const unsigned int BLOCK_SIZE = 100000;
+  const unsigned int MIN_LINES_PER_THREAD = 1000;
+
+  // Statistics of the records [first, last) of a block; each thread has its
+  // own statistics which are merged afterwards.
+  template<class T>
+  struct Chunk {
+    unsigned int first;
+    unsigned int last;
+    std::vector<T> stats;
+    bool failed;
+    std::string error;
+  };
+
+  template<class T>
+  void update_chunk(const FWFBlock* block, const std::vector<const Column*>* columns,
+      Chunk<T>* chunk) {
+    try {
+      for (unsigned int record = chunk->first; record < chunk->last; ++record) {
+        for (unsigned int i = 0; i < columns->size(); ++i) {
+          const Column* column = (*columns)[i];
+          unsigned int j = column->get_column_number();
+          chunk->stats[i].update(column, block->get_buffer(record, j), 
+            block->get_length(record, j), block->first_line() + record + 1);
+        }
+      }
+    } catch(const std::exception& e) {
+      chunk->failed = true;
+      chunk->error = e.what();
+    }
+  }
+
+  // The records of fixed width files can be located without parsing the
+  // file; blocks of records are split over the threads.
+  template<class T>
+  void iterate_parallel(FWFReader* reader, const std::vector<const Column*>& columns,
+      std::vector<T>& stats) {
+    std::vector<unsigned int> column_numbers;
+    for (unsigned int i = 0; i < columns.size(); ++i) 
+      column_numbers.push_back(columns[i]->get_column_number());
+    FWFBlock block;
+    while (reader->read_records(block, BLOCK_SIZE, column_numbers) > 0) {
+      unsigned int nread = block.size();
+      unsigned int nthreads = std::min(reader->get_threads(), 
+        nread / MIN_LINES_PER_THREAD);
+      if (nthreads < 1) nthreads = 1;
+      unsigned int chunk_size = (nread + nthreads - 1) / nthreads;
+      std::vector< Chunk<T> > chunks(nthreads);
+      for (unsigned int i = 0; i < nthreads; ++i) {
+        chunks[i].first = std::min(i * chunk_size, nread);
+        chunks[i].last = std::min((i + 1) * chunk_size, nread);
+        chunks[i].stats.resize(columns.size());
+        chunks[i].failed = false;
+      }
+      std::vector<std::thread> threads;
+      threads.reserve(nthreads);
+      for (unsigned int i = 1; i < nthreads; ++i) {
+        try {
+          threads.push_back(std::thread(update_chunk<T>, &block, &columns, 
+            &chunks[i]));
+        } catch(const std::exception&) {
+          update_chunk(&block, &columns, &chunks[i]);
+        }
+      }
+      update_chunk(&block, &columns, &chunks[0]);
+      for (std::vector<std::thread>::iterator p = threads.begin(); p != threads.end(); ++p)
+        p->join();
+      for (unsigned int i = 0; i < nthreads; ++i) {
+        if (chunks[i].failed) throw std::runtime_error(chunks[i].error);
+        for (unsigned int j = 0; j < stats.size(); ++j) 
+          stats[j].merge(chunks[i].stats[j]);
+      }
+    }
+  }
+}
+
 template<class T> 
 SEXP iterate_column(Reader* reader, Rcpp::IntegerVector columns) {
   // initialize result
@@ -36,12 +118,25 @@ SEXP iterate_column(Reader* reader, Rcpp::IntegerVector columns) {
   std::vector<T> stats(ncolumns);
   // get reader
   if (reader) {
+    std::vector<unsigned int> used_columns(columns.begin(), columns.end());
+    reader->set_used_columns(used_columns);
     // start reading
     reader->reset();
-    while (reader->next_line()) {
-      for (int i = 0; i < ncolumns; ++i) {
-        Column* column = reader->get_column(columns[i]);
-        stats[i].update(column);
+    FWFReader* fwf_reader = dynamic_cast<FWFReader*>(reader);
+    std::vector<const Column*> parallel_columns;
+    for (int i = 0; i < ncolumns; ++i) {
+      Column* column = reader->get_column(columns[i]);
+      if (column->thread_safe()) parallel_columns.push_back(column);
+    }
+    if (fwf_reader && reader->get_threads() > 1 && 
+        parallel_columns.size() == static_cast<size_t>(ncolumns)) {
+      iterate_parallel(fwf_reader, parallel_columns, stats);
+    } else {
+      while (reader->next_line()) {
+        for (int i = 0; i < ncolumns; ++i) {
+          Column* column = reader->get_column(columns[i]);
+          stats[i].update(column);
+        }
       }
     }
   }
@@ -60,8 +155,15 @@ class Sum {
   public:
     Sum() : sum_(0.0), n_(0.0), missing_(0) {};
 
-    void update(Column* column) {
-      double value = column->get_double();
+    void update(const Column* column) {
+      add(column->get_double());
+    }
+    void update(const Column* column, const char* buffer, unsigned int length,
+        uint64_t line) {
+      add(column->get_double(buffer, length, line));
+    }
+
+    void add(double value) {
       if (isna(value)) missing_++;
       else {
         sum_ += value;
@@ -69,6 +171,12 @@ class Sum {
       }
     }
 
+    void merge(const Sum& other) {
+      sum_ += other.sum_;
+      n_ += other.n_;
+      missing_ += other.missing_;
+    }
+
     SEXP result() {
       return Rcpp::List::create(Rcpp::Named("sum") = Rcpp::wrap(sum_),
         Rcpp::Named("n") = Rcpp::wrap(n_),
@@ -95,12 +203,26 @@ class Freq {
   public:
     Freq() : missing_(0) {};
 
-    void update(Column* column) {
-      int value = column->get_int();
+    void update(const Column* column) {
+      add(column->get_int());
+    }
+    void update(const Column* column, const char* buffer, unsigned int length,
+        uint64_t line) {
+      add(column->get_int(buffer, length, line));
+    }
+
+    void add(int value) {
       if (isna(value)) missing_++;
       else table_[value] = table_[value] + 1;
     }
 
+    void merge(const Freq& other) {
+      for (std::map<int, int>::const_iterator p = other.table_.begin(); 
+          p != other.table_.end(); ++p) 
+        table_[p->first] += p->second;
+      missing_ += other.missing_;
+    }
+
     SEXP result() {
       std::vector<int> value;
       std::vector<int> count;
@@ -132,8 +254,23 @@ class Range {
   public:
     Range() : first_(true), min_(0.0), max_(0.0), missing_(0) {};
 
-    void update(Column* column) {
-      double value = column->get_double();
+    void update(const Column* column) {
+      add(column->get_double());
+    }
+    void update(const Column* column, const char* buffer, unsigned int length,
+        uint64_t line) {
+      add(column->get_double(buffer, length, line));
+    }
+
+    void merge(const Range& other) {
+      missing_ += other.missing_;
+      if (other.first_) return;
+      if (first_ || other.min_ < min_) min_ = other.min_;
+      if (first_ || other.max_ > max_) max_ = other.max_;
+      first_ = false;
+    }
+
+    void add(double value) {
       if (isna(value)) missing_++;
       else if (first_) {
         min_ = value;
@@ -177,11 +314,22 @@ class NMissing {
   public:
     NMissing() : missing_(0) {};
 
-    void update(Column* column) {
-      double value = column->get_double();
+    void update(const Column* column) {
+      add(column->get_double());
+    }
+    void update(const Column* column, const char* buffer, unsigned int length,
+        uint64_t line) {
+      add(column->get_double(buffer, length, line));
+    }
+
+    void add(double value) {
       if (isna(value)) missing_++;
     }
 
+    void merge(const NMissing& other) {
+      missing_ += other.missing_;
+    }
+
     SEXP result() {
       return Rcpp::List::create(Rcpp::Named("missing") = Rcpp::wrap(missing_));
     }
@@ -41,4 +41,24 @@ std::string StringColumn::get_value() const {
   //return std::string(reader_->get_buffer(column_), reader_->get_length(column_));
 }
 
+double StringColumn::get_double(const char* buffer, unsigned int length, 
+    uint64_t) const {
+  return chartostring(buffer, length, trim_).size();
+}
+
+int StringColumn::get_int(const char* buffer, unsigned int length, 
+    uint64_t) const {
+  return chartostring(buffer, length, trim_).size();
+}
+
+void StringColumn::assign_at(unsigned int i, const char* buffer, 
+    unsigned int length, uint64_t) {
+  v[index + i] = chartostring(buffer, length, trim_);
+}
+
+void StringColumn::assign_spans(unsigned int i, const FieldSpan* spans, 
+    unsigned int n, uint64_t) {
+  for (unsigned int j = 0; j < n; ++j) 
+    v[index + i + j] = chartostring(spans[j].buffer, spans[j].length, trim_);
+}
 
@@ -35,6 +35,10 @@ class StringColumn : public Column {
     int get_int() const {
       return get_value().size();
     }
+    double get_double(const char* buffer, unsigned int length, 
+      uint64_t line) const;
+    int get_int(const char* buffer, unsigned int length, 
+      uint64_t line) const;
 
     std::string get_value() const;
 
@@ -42,6 +46,11 @@ class StringColumn : public Column {
       v[index] = get_value();
     }
 
+    virtual void assign_at(unsigned int i, const char* buffer, 
+      unsigned int length, uint64_t line);
+    virtual void assign_spans(unsigned int i, const FieldSpan* spans, 
+      unsigned int n, uint64_t line);
+
     virtual void init(Rcpp::List::Proxy proxy) {
       v = proxy;
       index = 0;
@@ -16,48 +16,62 @@ LaF.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "LaF.h"
+#include "file.h"
 #include <fstream>
+#include <map>
 #include <string>
 #include <vector>
 
+namespace {
+  // Number of lines of the files counted by nlines. The count is only used
+  // when the size and modification time of the file have not changed.
+  struct LineCount {
+    FileIdentity identity;
+    uint64_t n;
+  };
+  std::map<std::string, LineCount> line_counts;
+}
 
-RcppExport SEXP nlines(SEXP r_filename) {
+RcppExport SEXP nlines(SEXP r_filename, SEXP r_threads) {
 BEGIN_RCPP
   Rcpp::CharacterVector filenamev(r_filename);
   std::string filename = static_cast<char*>(filenamev[0]);
+  Rcpp::IntegerVector threadsv(r_threads);
+  unsigned int threads = static_cast<unsigned int>(threadsv[0]);
+  FileIdentity identity;
+  if (!get_file_identity(filename, identity))
+    throw std::runtime_error("Failed to open file '" + filename + "'.");
+  std::map<std::string, LineCount>::const_iterator cached = line_counts.find(filename);
+  if (cached != line_counts.end() && cached->second.identity == identity) 
+    return Rcpp::wrap(static_cast<double>(cached->second.n));
+  // the size of the file is only used to split the file into parts; the 
+  // last part extends to the end of the file
+  std::vector<uint64_t> bounds = split_range(0, identity.size, threads);
+  bounds.back() = END_OF_FILE;
+  std::vector<uint64_t> counts = count_newlines(filename, bounds);
+  uint64_t n = 0;
+  for (std::vector<uint64_t>::const_iterator p = counts.begin(); p != counts.end(); ++p)
+    n += *p;
+  // when the last line does not end with a line ending it is also counted
   std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
-  char buffer[1000000];
-  char* bp;
-  unsigned int n = 0;
-  bool incomplete_line = false;
-  while (true) {
-    input.read(buffer, 1000000);
-    unsigned int nread = input.gcount();
-    if (nread == 0) break;
-    bp = buffer;
-    for (unsigned int i = 0; i < nread; ++i, ++bp) {
-      if (*bp == '\n') {
-        incomplete_line = false;
-	n++;
-      } else {
-        incomplete_line = true;
-      }
-    }
-    if (input.eof()) break;
+  if (input.seekg(0, std::ios::end) && input.tellg() > 0) {
+    input.seekg(-1, std::ios::end);
+    if (input.get() != '\n') n++;
   }
-  if (incomplete_line) n++;
-  return Rcpp::wrap(n);
+  LineCount count = {identity, n};
+  line_counts[filename] = count;
+  return Rcpp::wrap(static_cast<double>(n));
 END_RCPP
 }
 
 std::vector<std::string> get_line(const std::string& filename, 
-    std::vector<int> line_numbers) {
+    const std::vector<uint64_t>& line_numbers) {
   std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
   char buffer[1000000];
   char* bp;
-  int n = 0;
+  uint64_t n = 0;
   unsigned int line_index = 0;
-  int line_number = line_numbers[line_index];
+  uint64_t line_number = line_numbers[line_index];
   std::vector<std::string> result;
   std::string current_line = std::string();
   // start reading until line number
@@ -90,15 +104,15 @@ std::vector<std::string> get_line(const std::string& filename,
 }
 
 std::vector<std::string> get_lines(const std::string& filename,
-    const std::vector<unsigned int>& line_numbers) {
+    const std::vector<uint64_t>& line_numbers) {
   
   std::vector<std::string> lines;
   std::ifstream input(filename.c_str(), std::ios::in|std::ios::binary);
   char buffer[1000000];
   char* bp;
-  unsigned int n = 0;
+  uint64_t n = 0;
   unsigned int current_i = 0;
-  unsigned int current_n = line_numbers[current_i];
+  uint64_t current_n = line_numbers[current_i];
   std::string current_line = std::string();
   // start reading until line number
   while (true) {
@@ -131,7 +145,8 @@ RcppExport SEXP r_get_line(SEXP r_filename, SEXP r_line_numbers) {
 BEGIN_RCPP
   Rcpp::CharacterVector filenamev(r_filename);
   std::string filename = static_cast<char*>(filenamev[0]);
-  std::vector<int> line_numbers = Rcpp::as< std::vector<int> >(r_line_numbers);
+  std::vector<double> line_numbersv = Rcpp::as< std::vector<double> >(r_line_numbers);
+  std::vector<uint64_t> line_numbers(line_numbersv.begin(), line_numbersv.end());
   std::vector<std::string> result = get_line(filename, line_numbers);
   return Rcpp::wrap(result);
 END_RCPP